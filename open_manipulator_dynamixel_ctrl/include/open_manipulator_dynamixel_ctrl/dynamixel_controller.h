@@ -57,6 +57,7 @@ class DynamixelController
 
   // Dynamixel Workbench Parameters
   std::string robot_name_;
+  double control_rate_;
   float protocol_version_;
 
   DynamixelWorkbench *joint_controller_;
@@ -67,11 +68,13 @@ class DynamixelController
 
   std::string joint_mode_;
   std::string gripper_mode_;
+  int32_t gripper_goal_current_;    // last written Goal_Current in current_mode, raw value
 
  public:
   DynamixelController();
   ~DynamixelController();
   bool control_loop();
+  double getControlRate() { return control_rate_; }
 
  private:
   void initMsg();
@@ -27,9 +27,11 @@ double mapd(double x, double in_min, double in_max, double out_min, double out_m
 
 DynamixelController::DynamixelController()
     :node_handle_(""),
-     priv_node_handle_("~")
+     priv_node_handle_("~"),
+     gripper_goal_current_(0)
 {
   robot_name_   = priv_node_handle_.param<std::string>("robot_name", "open_manipulator");
+  control_rate_ = priv_node_handle_.param<double>("control_rate", ITERATION_FREQUENCY);
 
   std::string device_name   = priv_node_handle_.param<std::string>("device_name", "/dev/ttyUSB0");
   uint32_t dxl_baud_rate    = priv_node_handle_.param<int>("baud_rate", 1000000);
@@ -77,7 +79,8 @@ void DynamixelController::initPublisher()
 
 void DynamixelController::initSubscriber()
 {
-  goal_joint_states_sub_    = node_handle_.subscribe(robot_name_ + "/goal_joint_position", 10, &DynamixelController::goalJointPositionCallback, this);
+  goal_joint_states_sub_    = node_handle_.subscribe(robot_name_ + "/goal_joint_position", 10, &DynamixelController::goalJointPositionCallback, this,
+                                                       ros::TransportHints().tcpNoDelay());
   goal_gripper_states_sub_  = node_handle_.subscribe(robot_name_ + "/goal_gripper_position", 10, &DynamixelController::goalGripperPositionCallback, this);
 }
 
@@ -129,7 +132,10 @@ void DynamixelController::setOperatingMode()
   if (gripper_mode_ == "position_mode")
     gripper_controller_->jointMode(gripper_id_.at(0));
   else if (gripper_mode_ == "current_mode" && protocol_version_ == 2.0)
-    gripper_controller_->currentMode(gripper_id_.at(0), 50);
+  {
+    gripper_goal_current_ = 50;
+    gripper_controller_->currentMode(gripper_id_.at(0), gripper_goal_current_);
+  }
   else
     gripper_controller_->jointMode(gripper_id_.at(0));
 }
@@ -219,6 +225,15 @@ void DynamixelController::updateJointStates()
   readPosition(get_joint_position);
   // readVelocity(get_joint_velocity);
 
+  // Gripper current is reported as effort in current_mode, it tells when an object is held
+  if (gripper_goal_current_ > 0)
+  {
+    int16_t get_gripper_present_current = (int16_t)gripper_controller_->itemRead(gripper_id_.at(0), "Present_Current");
+
+    joint_states_eff[4] = get_gripper_present_current;
+    joint_states_eff[5] = joint_states_eff[4];
+  }
+
   joint_state.header.frame_id = "world";
   joint_state.header.stamp    = ros::Time::now();
 
@@ -275,6 +290,18 @@ void DynamixelController::goalGripperPositionCallback(const sensor_msgs::JointSt
   double goal_gripper_position = msg->position[0];
   goal_gripper_position = mapd(goal_gripper_position, -0.01, 0.01, 0.90, -0.80);
 
+  // In current_mode the effort is the Goal_Current (raw value) limiting the grip force, written only when it changes
+  if (gripper_goal_current_ > 0 && msg->effort.size() > 0)
+  {
+    int32_t goal_current = (int32_t)msg->effort[0];
+
+    if (goal_current > 0 && goal_current != gripper_goal_current_)
+    {
+      gripper_controller_->itemWrite(gripper_id_.at(0), "Goal_Current", goal_current);
+      gripper_goal_current_ = goal_current;
+    }
+  }
+
   gripper_controller_->itemWrite(gripper_id_.at(0), "Goal_Position", gripper_controller_->convertRadian2Value(gripper_id_.at(0), goal_gripper_position));
 }
 
@@ -289,7 +316,7 @@ int main(int argc, char **argv)
   // Init ROS node
   ros::init(argc, argv, "open_manipulator_dynamixel_controller");
   DynamixelController dynamixel_controller;
-  ros::Rate loop_rate(ITERATION_FREQUENCY);
+  ros::Rate loop_rate(dynamixel_controller.getControlRate());
 
   while (ros::ok())
   {
@@ -0,0 +1,114 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef BATCH_TRAJECTORY_FILTER_H_
+#define BATCH_TRAJECTORY_FILTER_H_
+
+#include <industrial_trajectory_filters/work_stealing_pool.h>
+
+#include <moveit/planning_interface/planning_interface.h>
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit_msgs/RobotTrajectory.h>
+#include <pluginlib/class_loader.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+namespace industrial_trajectory_filters
+{
+
+typedef struct
+{
+  bool        success;
+  std::size_t input_points;
+  std::size_t output_points;
+  double      filter_time;      // sec, wall time of the pipeline
+} BatchTrajectoryResult;
+
+/**
+ * @brief Applies a pipeline of planning request adapters to many trajectories at once,
+ * outside move_group.
+ *
+ * The pipeline is given like the request_adapters of move_group, the first adapter is the
+ * outermost one and runs last. The adapters read their parameters from the private
+ * namespace of the node, as they do in move_group. Every worker thread gets its own
+ * instance of each adapter and its own planning scene, since the filters keep working
+ * state, and the trajectories are spread over the workers by a WorkStealingPool.
+ */
+class BatchTrajectoryFilter
+{
+public:
+  BatchTrajectoryFilter();
+  ~BatchTrajectoryFilter();
+
+  /**
+   * @brief Loads the adapters for every worker
+   * @param robot_model model the trajectories are given for
+   * @param adapter_names plugin names, outermost first
+   * @param thread_num number of worker threads, 0 for one per core
+   * @return false if an adapter could not be loaded
+   */
+  bool init(const robot_model::RobotModelConstPtr& robot_model, const std::vector<std::string>& adapter_names,
+            std::size_t thread_num = 0);
+
+  /**
+   * @brief Filters the trajectories in parallel, filtered[i] and results[i] belong to trajectories[i].
+   * A trajectory the pipeline fails on is copied unchanged and marked in its result.
+   * @param trajectories trajectories to filter
+   * @param req request seen by the adapters (group name, scaling factors, path constraints)
+   * @return true if every trajectory was filtered
+   */
+  bool process(const std::vector<moveit_msgs::RobotTrajectory>& trajectories,
+               const planning_interface::MotionPlanRequest& req,
+               std::vector<moveit_msgs::RobotTrajectory>& filtered,
+               std::vector<BatchTrajectoryResult>& results);
+
+  std::size_t getThreadNum() const { return workers_.size(); }
+
+private:
+  typedef planning_request_adapter::PlanningRequestAdapter::PlannerFn PlannerFn;
+  typedef std::vector<planning_request_adapter::PlanningRequestAdapterPtr> AdapterChain;
+
+  struct Worker
+  {
+    AdapterChain adapters;
+    planning_scene::PlanningScenePtr planning_scene;
+  };
+
+  bool filterTrajectory(const moveit_msgs::RobotTrajectory& trajectory, const planning_interface::MotionPlanRequest& req,
+                        Worker& worker, moveit_msgs::RobotTrajectory& filtered, BatchTrajectoryResult& result);
+
+  /**
+   * @brief Calls the adapter at index with the rest of the chain as its planner
+   */
+  static bool callAdapter(const AdapterChain& adapters, std::size_t index, const PlannerFn& planner,
+                          const planning_scene::PlanningSceneConstPtr& planning_scene,
+                          const planning_interface::MotionPlanRequest& req,
+                          planning_interface::MotionPlanResponse& res);
+
+  robot_model::RobotModelConstPtr robot_model_;
+  boost::shared_ptr<pluginlib::ClassLoader<planning_request_adapter::PlanningRequestAdapter> > adapter_loader_;
+  std::vector<Worker> workers_;             // destroyed before the loader of their adapters
+  boost::shared_ptr<WorkStealingPool> pool_;
+};
+
+}
+
+#endif /* BATCH_TRAJECTORY_FILTER_H_ */
@@ -33,6 +33,7 @@
 #define N_POINT_FILTER_H_
 
 #include <industrial_trajectory_filters/filter_base.h>
+#include <industrial_trajectory_filters/trajectory_filter_base.h>
 
 namespace industrial_trajectory_filters
 {
@@ -84,6 +85,32 @@ template<typename T>
  */
 typedef NPointFilter<MessageAdapter> NPointFilterAdapter;
 
+/**
+ * @brief NPointFilter working on the planned robot trajectory in place
+ */
+class NPointTrajectoryFilter : public industrial_trajectory_filters::TrajectoryFilterBase
+{
+public:
+  NPointTrajectoryFilter();
+
+  /**
+   * \brief Reduces a trajectory to N points or less, keeping the waypoints (and
+   * their times from start) that NPointFilter keeps.
+   * @param trajectory trajectory to reduce
+   * @return true if successful
+   */
+  virtual bool update(robot_trajectory::RobotTrajectory& trajectory);
+
+protected:
+  virtual bool configure();
+
+private:
+  /**
+   * @brief number of points to reduce trajectory to
+   */
+  int n_points_;
+};
+
 }
 
 #endif
@@ -0,0 +1,97 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef REDUCE_WAYPOINTS_FILTER_H_
+#define REDUCE_WAYPOINTS_FILTER_H_
+
+#include <industrial_trajectory_filters/trajectory_filter_base.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <string>
+#include <vector>
+
+namespace industrial_trajectory_filters
+{
+
+/**
+ * @brief Drops the waypoints that the straight joint space segments between the kept ones
+ * pass within a tolerance (Ramer-Douglas-Peucker), in place of the index based NPointFilter.
+ *
+ * A segment between two kept waypoints is split at the waypoint farthest from it until every
+ * dropped waypoint is within the tolerance. The deviation is measured in joint space (largest
+ * joint error to the segment) or in Cartesian space (tip link position error of the segment
+ * state closest in joint space). With validation, segments that leave the valid states of the
+ * planning scene are split as well. The kept waypoints keep their times from start.
+ */
+class ReduceWaypointsFilter : public industrial_trajectory_filters::TrajectoryFilterBase
+{
+public:
+  ReduceWaypointsFilter();
+
+  /**
+   * \brief Reduces the trajectory within the tolerance, without validation.
+   * @param trajectory trajectory to reduce
+   * @return true if successful
+   */
+  virtual bool update(robot_trajectory::RobotTrajectory& trajectory);
+
+  /**
+   * \brief Reduces the trajectory within the tolerance, validating the segments in the planning scene.
+   * @param planning_scene scene the trajectory was planned in
+   * @param req motion plan request (group, path constraints)
+   * @param trajectory trajectory to reduce
+   * @return true if successful
+   */
+  virtual bool updateInScene(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                             const planning_interface::MotionPlanRequest& req,
+                             robot_trajectory::RobotTrajectory& trajectory);
+
+protected:
+  virtual bool configure();
+
+private:
+  bool reduce(robot_trajectory::RobotTrajectory& trajectory, const planning_scene::PlanningSceneConstPtr& planning_scene,
+              const planning_interface::MotionPlanRequest* req);
+
+  /**
+   * @brief Deviation of a waypoint from the segment between two others, in rad or m
+   */
+  double getDeviation(const robot_trajectory::RobotTrajectory& trajectory, int first, int last, int index);
+
+  /**
+   * @brief Checks the states along the segment at the validation resolution
+   */
+  bool isSegmentValid(const robot_trajectory::RobotTrajectory& trajectory, int first, int last,
+                      const planning_scene::PlanningSceneConstPtr& planning_scene,
+                      const planning_interface::MotionPlanRequest& req);
+
+  bool is_cartesian_;
+  double joint_tolerance_;          // rad
+  double cartesian_tolerance_;      // m
+  bool validate_;
+  double validation_resolution_;    // rad, largest joint step between checked states
+  std::string tip_link_;            // empty: last link of the trajectory group
+
+  std::vector<int> variable_index_;                // variables of the trajectory group
+  std::string segment_tip_link_;
+  std::vector<Eigen::Vector3d> tip_position_;      // per waypoint, cartesian deviation only
+  robot_state::RobotStatePtr segment_state_;
+};
+
+}
+
+#endif /* REDUCE_WAYPOINTS_FILTER_H_ */
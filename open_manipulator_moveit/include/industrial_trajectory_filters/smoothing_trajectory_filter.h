@@ -38,6 +38,7 @@
 #define MOVEIT_TRAJECTORY_PROCESSING_SMOOTHING_TRAJECTORY_FILTER_
 
 #include <moveit/robot_trajectory/robot_trajectory.h>
+#include <Eigen/Core>
 
 namespace industrial_trajectory_filters
 {
@@ -58,16 +59,58 @@ public:
    */
   bool init(std::vector<double> &coef);
 
-  /* \brief action of filter depends on the coefficients, intended to be a low pass filter
+  /*!  \brief Savitzky-Golay mode, a least squares polynomial fit over a sliding window
+   *    @param window   number of waypoints in the window, odd
+   *    @param order    order of the fitted polynomial, at least 2 and less than window
+   *    @return  true if the window and order are valid, otherwise, false
+   *
+   *    Positions, velocities and accelerations all come from the same local fit, so the
+   *    derivatives are consistent with the smoothed positions.
+   */
+  bool initSavitzkyGolay(int window, int order);
+
+  /* \brief action of filter depends on the coefficients, intended to be a low pass filter.
+   *  All variables are convolved together on a time major copy of the trajectory.
+   *  In Savitzky-Golay mode the velocities and accelerations of a timed trajectory are
+   *  replaced by the derivatives of the fit as well.
    *  @param rob_trajectory   A robot_trajectory::RobotTrajectory to be filtered
    */
   bool applyFilter(robot_trajectory::RobotTrajectory& rob_trajectory) const;  
 
+  /*! \brief Time major waypoint matrix, one row of variable positions per waypoint */
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> WayPointMatrix;
+
+  /* \brief same filter on positions that are already gathered, the first and last rows are not changed
+   *  @param positions   waypoint matrix to be filtered in place
+   */
+  bool applyFilter(WayPointMatrix& positions) const;
+
+  /* \brief Savitzky-Golay mode only, smoothed positions and their derivatives per waypoint step
+   *  (divide by the sample time, squared for the accelerations). The first and last positions are not
+   *  changed, their derivative rows are the end slopes without acceleration
+   *  @param positions   waypoint matrix to be filtered in place
+   *  @param velocities   first derivatives of the fit, same size as positions
+   *  @param accelerations   second derivatives of the fit, same size as positions
+   */
+  bool applyFilter(WayPointMatrix& positions, WayPointMatrix& velocities, WayPointMatrix& accelerations) const;
+
+  /*! \brief true in Savitzky-Golay mode */
+  bool isSavitzkyGolay() const { return is_savitzky_golay_; }
+
 private:
+  /* \brief time major copy extended by half the kernel on both sides, along the end slopes */
+  void extendWayPoints(const WayPointMatrix& positions, WayPointMatrix& xv) const;
+
+  /* \brief rows 1 to num_points-2 of the convolution of the extended copy with one kernel */
+  void convolve(const WayPointMatrix& xv, const std::vector<double>& coef, WayPointMatrix& output) const;
+
   double gain_; /*!< gain_ is the sum of the coeficients to achieve unity gain overall */
   int num_coef_; /*< the number of coefficients  */
   std::vector<double> coef_; /*!< Vector of coefficients  */ 
   bool initialized_; /*!< was the init() function called sucessfully? */
+  bool is_savitzky_golay_; /*!< coef_ is the position kernel of a Savitzky-Golay fit */
+  std::vector<double> velocity_coef_; /*!< first derivative kernel of the fit, per waypoint step */
+  std::vector<double> acceleration_coef_; /*!< second derivative kernel of the fit, per waypoint step squared */
 };
 
 }
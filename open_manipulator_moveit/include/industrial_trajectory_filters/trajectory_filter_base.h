@@ -0,0 +1,130 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef TRAJECTORY_FILTER_BASE_H_
+#define TRAJECTORY_FILTER_BASE_H_
+
+#include <ros/ros.h>
+#include <ros/console.h>
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <class_loader/class_loader.h>
+
+#include <sstream>
+
+namespace industrial_trajectory_filters
+{
+
+/**
+ * @brief Planning request adapter for filters that work directly on the planned
+ * robot_trajectory::RobotTrajectory.
+ *
+ * FilterBase<MessageAdapter> converts the plan into a JointTrajectory message, runs
+ * update() into a second message and rebuilds the trajectory from it. Filters derived
+ * from this class skip those conversions and modify res.trajectory_ in place.
+ */
+class TrajectoryFilterBase : public planning_request_adapter::PlanningRequestAdapter
+{
+ public:
+  TrajectoryFilterBase() :
+      planning_request_adapter::PlanningRequestAdapter(), nh_("~"), configured_(false), filter_type_("TrajectoryFilterBase"),
+      filter_name_("Unimplemented")
+  {
+  }
+
+  virtual ~TrajectoryFilterBase()
+  {
+  }
+
+  /**
+   * @brief Filters the trajectory in place. This function must be implemented in the derived class.
+   * @param trajectory planned trajectory, replaced by the filtered one
+   * @return true on success, otherwise false (the trajectory is left as planned).
+   */
+  virtual bool update(robot_trajectory::RobotTrajectory& trajectory) = 0;
+
+  /**
+   * @brief Filters the trajectory in place, with the planning scene and the request it was planned for.
+   * The default calls update(trajectory), filters that check their result against the scene override it.
+   * @param planning_scene scene the trajectory was planned in
+   * @param req motion plan request (group, path constraints)
+   * @param trajectory planned trajectory, replaced by the filtered one
+   * @return true on success, otherwise false (the trajectory is left as planned).
+   */
+  virtual bool updateInScene(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                             const planning_interface::MotionPlanRequest& req,
+                             robot_trajectory::RobotTrajectory& trajectory)
+  {
+    return update(trajectory);
+  }
+
+  std::string getType() const
+  {
+    return filter_type_;
+  }
+
+  const std::string& getName() const
+  {
+    return filter_name_;
+  }
+
+  virtual std::string getDescription() const
+  {
+    std::stringstream ss;
+    ss << "Trajectory filter '" << getName() << "' of type '" << getType() << "'";
+    return ss.str();
+  }
+
+  virtual bool adaptAndPlan(const PlannerFn &planner, const planning_scene::PlanningSceneConstPtr &planning_scene,
+                            const planning_interface::MotionPlanRequest &req,
+                            planning_interface::MotionPlanResponse &res,
+                            std::vector<std::size_t> &added_path_index) const
+  {
+    // non const pointer to this
+    TrajectoryFilterBase *p = const_cast<TrajectoryFilterBase*>(this);
+
+    if (!configured_ && p->configure())
+    {
+      p->configured_ = true;
+    }
+
+    bool result = planner(planning_scene, req, res);
+
+    if (result && res.trajectory_)
+    {
+      if (!p->updateInScene(planning_scene, req, *res.trajectory_))
+        ROS_ERROR_STREAM(getDescription() << " failed, the trajectory is not filtered");
+    }
+
+    return result;
+  }
+
+ protected:
+  /**
+   * @brief Reads the filter parameters, called once before the first update.
+   * @return true if successful, otherwise false (called again on the next plan).
+   */
+  virtual bool configure() = 0;
+
+  ros::NodeHandle nh_;
+  bool configured_;
+  std::string filter_type_;
+  std::string filter_name_;
+};
+
+}
+
+#endif /* TRAJECTORY_FILTER_BASE_H_ */
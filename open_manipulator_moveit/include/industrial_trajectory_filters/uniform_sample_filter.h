@@ -33,6 +33,7 @@
 #define UNIFORM_SAMPLE_FILTER_H_
 
 #include <industrial_trajectory_filters/filter_base.h>
+#include <industrial_trajectory_filters/trajectory_filter_base.h>
 
 /*
  * These headers were part of the trajectory filter interface from the
@@ -45,9 +46,36 @@
 namespace industrial_trajectory_filters
 {
 
+/**
+ * @brief Quintic splines of all joints between two trajectory points, the same as
+ * KDL::VelocityProfile_Spline with position, velocity and acceleration at both ends.
+ * Fitted once per segment and evaluated for every sample inside it.
+ */
+class QuinticSegment
+{
+public:
+  /**
+   * @brief Fits the splines from point 1 to point 2, a zero duration holds point 2.
+   */
+  void fit(const double * pos1, const double * vel1, const double * acc1,
+           const double * pos2, const double * vel2, const double * acc2, size_t size, double duration);
+
+  /**
+   * @brief Evaluates the fitted splines into arrays of the fitted size.
+   * @param time_from_p1 time since point 1
+   */
+  void sample(double time_from_p1, double * pos, double * vel, double * acc) const;
+
+private:
+  /**
+   * @brief coefficients c0..c5 of every joint
+   */
+  std::vector<double> coefficients_;
+};
+
 /**
  * \brief This is a simple filter which performs a uniforming sampling of
- * a trajectory using linear interpolation.
+ * a trajectory using quintic spline interpolation.
  *
  */
 template<typename T>
@@ -71,29 +99,25 @@ template<typename T>
      * sample duration.  Sampling is performed via interpolation ensuring smooth
      * velocity and acceleration.  NOTE: For this reason trajectories must be
      * fully defined before using this filter.
+     *
+     * The spline of each input segment is fitted once and the output times are
+     * walked with a segment cursor, the output points are sized before sampling.
      * @param trajectory_in non uniform trajectory
      * @param trajectory_out uniform(in terms of time) trajectory
      * @return
      */
     bool update(const T& trajectory_in, T& trajectory_out);
 
-    /**
-     * @brief Perform interpolation between p1 and p2.  Time from start must be
-     * in between p1 and p2 times.
-     * @param p1 prior trajectory point
-     * @param p2 subsequent trajectory point
-     * @param time_from_start time from start of trajectory (i.e. p0).
-     * @param interp_pt resulting interpolated point
-     * @return true if successful, otherwise false.
-     */
-    bool interpolatePt(trajectory_msgs::JointTrajectoryPoint & p1, trajectory_msgs::JointTrajectoryPoint & p2,
-                       double time_from_start, trajectory_msgs::JointTrajectoryPoint & interp_pt);
-
   private:
     /**
      * @brief uniform sample duration (sec)
      */
     double sample_duration_;
+
+    /**
+     * @brief splines of the current input segment
+     */
+    QuinticSegment segment_;
   };
 
 /**
@@ -101,6 +125,44 @@ template<typename T>
  */
 typedef UniformSampleFilter<MessageAdapter> UniformSampleFilterAdapter;
 
+/**
+ * @brief UniformSampleFilter working on the planned robot trajectory in place.
+ * Every variable of the waypoints is sampled, so they must carry velocities and
+ * accelerations (i.e. run after time parameterization).
+ */
+class UniformSampleTrajectoryFilter : public industrial_trajectory_filters::TrajectoryFilterBase
+{
+public:
+  UniformSampleTrajectoryFilter();
+
+  /**
+   * Uniformly samples(in terms of time) the trajectory based upon the sample
+   * duration, with the same samples as UniformSampleFilter.
+   * @param trajectory non uniform trajectory, replaced by the uniform one
+   * @return true if successful
+   */
+  virtual bool update(robot_trajectory::RobotTrajectory& trajectory);
+
+protected:
+  virtual bool configure();
+
+private:
+  /**
+   * @brief uniform sample duration (sec)
+   */
+  double sample_duration_;
+
+  /**
+   * @brief splines of the current input segment
+   */
+  QuinticSegment segment_;
+
+  /**
+   * @brief positions of the current sample
+   */
+  std::vector<double> sample_position_;
+};
+
 }
 
 #endif
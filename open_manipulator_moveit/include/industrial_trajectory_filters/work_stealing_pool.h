@@ -0,0 +1,76 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef WORK_STEALING_POOL_H_
+#define WORK_STEALING_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace industrial_trajectory_filters
+{
+
+/**
+ * @brief Runs a batch of independent tasks on a fixed number of threads.
+ *
+ * Every worker starts with a contiguous block of the task indices and takes them from the
+ * front of its own queue. A worker that runs out steals half of what is left at the back of
+ * another queue, so a few long trajectories do not leave the other cores idle.
+ */
+class WorkStealingPool
+{
+public:
+  /**
+   * @brief Task of the given index, run by the given worker (0 to getThreadNum() - 1)
+   */
+  typedef std::function<void(std::size_t index, std::size_t worker)> Task;
+
+  /**
+   * @param thread_num number of worker threads, 0 for one per core
+   */
+  explicit WorkStealingPool(std::size_t thread_num = 0);
+
+  std::size_t getThreadNum() const { return queues_.size(); }
+
+  /**
+   * @brief Runs task for every index in [0, task_num) and returns when all are done.
+   * The first exception thrown by a task is rethrown here, after the other tasks ran.
+   */
+  void run(std::size_t task_num, const Task& task);
+
+private:
+  struct WorkQueue
+  {
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+  };
+
+  void work(std::size_t worker, const Task& task);
+  bool popTask(std::size_t worker, std::size_t& index);
+  bool stealTasks(std::size_t worker);
+
+  std::vector<std::unique_ptr<WorkQueue> > queues_;
+
+  std::mutex exception_mutex_;
+  std::exception_ptr exception_;
+};
+
+}
+
+#endif /* WORK_STEALING_POOL_H_ */
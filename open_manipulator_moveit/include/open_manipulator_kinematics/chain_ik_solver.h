@@ -0,0 +1,109 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_CHAIN_IK_SOLVER_H
+#define OPEN_MANIPULATOR_CHAIN_IK_SOLVER_H
+
+#include <eigen3/Eigen/Eigen>
+
+namespace open_manipulator_kinematics
+{
+#define CHAIN_JOINT_NUM       4
+#define CHAIN_MAX_SOLUTIONS   4     // two yaw branches x two elbow branches
+
+/**
+ * @brief Geometry of the yaw + three-pitch chain (joint1 ~ joint4).
+ *
+ * joint1 rotates about the base z axis, joint2 ~ joint4 rotate about the y axis
+ * of the yawed frame, so everything after joint1 moves in a vertical plane.
+ * Planar offsets are given as (radial, height) pairs in that plane with all
+ * joints at zero.
+ */
+typedef struct
+{
+  double yaw_axis_x, yaw_axis_y;         // joint1 axis position in the base frame
+  double shoulder_x, shoulder_z;         // joint2 axis, radial offset from joint1 axis and height
+  double upper_arm_x, upper_arm_z;       // joint2 -> joint3
+  double forearm_x, forearm_z;           // joint3 -> joint4
+  double tip_x, tip_z;                   // joint4 -> tip frame
+} ChainGeometry;
+
+typedef struct
+{
+  double position[CHAIN_JOINT_NUM];
+} ChainSolution;
+
+/**
+ * @brief Closed-form inverse kinematics of the OpenManipulator arm.
+ *
+ * The tip pose of this chain has four degrees of freedom: position and the
+ * pitch of the tip about the yawed y axis. Given those, joint1 follows from the
+ * target position and joint2 ~ joint4 from a planar two-link problem, which
+ * yields up to two yaw branches times two elbow branches.
+ */
+class ChainIKSolver
+{
+ private:
+  ChainGeometry geometry_;
+
+  double lower_limit_[CHAIN_JOINT_NUM];
+  double upper_limit_[CHAIN_JOINT_NUM];
+
+  double orientation_tolerance_;
+
+ public:
+  ChainIKSolver();
+
+  void setGeometry(const ChainGeometry &geometry);
+  void setJointLimits(const double *lower, const double *upper);
+  void setOrientationTolerance(double tolerance);
+
+  const ChainGeometry &getGeometry() const { return geometry_; }
+
+  /**
+   * @brief Tip pose for the given joint positions
+   * @param position joint1 ~ joint4
+   * @param tip_position resulting tip position in the base frame
+   * @param pitch resulting tip pitch (joint2 + joint3 + joint4)
+   */
+  void forward(const double *position, Eigen::Vector3d &tip_position, double &pitch) const;
+  void forward(const double *position, Eigen::Vector3d &tip_position, Eigen::Matrix3d &tip_orientation) const;
+
+  /**
+   * @brief All solutions within joint limits reaching the tip position with the given pitch
+   * @param seed_yaw joint1 used when the target lies on the joint1 axis
+   * @return number of solutions written to solutions (at most CHAIN_MAX_SOLUTIONS)
+   */
+  int solve(const Eigen::Vector3d &tip_position, double pitch, double seed_yaw,
+            ChainSolution *solutions) const;
+
+  /**
+   * @brief All solutions within joint limits reaching the tip pose. The pitch is taken
+   * from the target orientation; yaw branches whose reachable orientation differs from
+   * the target by more than the orientation tolerance are rejected.
+   */
+  int solve(const Eigen::Vector3d &tip_position, const Eigen::Matrix3d &tip_orientation, double seed_yaw,
+            ChainSolution *solutions) const;
+
+  bool withinLimits(const double *position) const;
+
+ private:
+  int solveBranch(double yaw, double radial, double height, double pitch, ChainSolution *solutions) const;
+  bool fitToLimits(int joint, double &position) const;
+};
+}
+
+#endif /*OPEN_MANIPULATOR_CHAIN_IK_SOLVER_H*/
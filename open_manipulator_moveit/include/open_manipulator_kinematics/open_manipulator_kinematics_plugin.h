@@ -0,0 +1,145 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_KINEMATICS_PLUGIN_H
+#define OPEN_MANIPULATOR_KINEMATICS_PLUGIN_H
+
+#include <ros/ros.h>
+
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <moveit_msgs/MoveItErrorCodes.h>
+#include <geometry_msgs/Pose.h>
+
+#include <vector>
+#include <string>
+
+#include "open_manipulator_kinematics/chain_ik_solver.h"
+
+namespace open_manipulator_kinematics
+{
+/**
+ * @brief Analytic kinematics plugin for the OpenManipulator arm group.
+ *
+ * Solves tip position and pitch in closed form with ChainIKSolver. With
+ * position_only_ik the pitch is free: the seed pitch is tried first and the
+ * pitch is then swept outwards at the search discretization until a solution
+ * is found or the timeout expires (getPositionIK: the kinematics_solver_timeout).
+ *
+ * ROS parameters (robot_description_kinematics/<group>/):
+ * - position_only_ik (default = false)
+ * - orientation_tolerance (default = 0.001 rad)
+ */
+class OpenManipulatorKinematicsPlugin : public kinematics::KinematicsBase
+{
+ private:
+  bool active_;
+  bool position_only_ik_;
+  double pitch_discretization_;
+
+  robot_model::RobotModelPtr robot_model_;
+  const robot_model::JointModelGroup *joint_model_group_;
+
+  std::vector<std::string> joint_names_;
+  std::vector<std::string> link_names_;
+
+  ChainIKSolver solver_;
+
+ public:
+  OpenManipulatorKinematicsPlugin();
+  virtual ~OpenManipulatorKinematicsPlugin();
+
+  virtual bool initialize(const std::string &robot_description,
+                          const std::string &group_name,
+                          const std::string &base_frame,
+                          const std::string &tip_frame,
+                          double search_discretization);
+
+  virtual bool getPositionIK(const geometry_msgs::Pose &ik_pose,
+                             const std::vector<double> &ik_seed_state,
+                             std::vector<double> &solution,
+                             moveit_msgs::MoveItErrorCodes &error_code,
+                             const kinematics::KinematicsQueryOptions &options = kinematics::KinematicsQueryOptions()) const;
+
+  virtual bool getPositionIK(const std::vector<geometry_msgs::Pose> &ik_poses,
+                             const std::vector<double> &ik_seed_state,
+                             std::vector<std::vector<double> > &solutions,
+                             kinematics::KinematicsResult &result,
+                             const kinematics::KinematicsQueryOptions &options) const;
+
+  virtual bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                                const std::vector<double> &ik_seed_state,
+                                double timeout,
+                                std::vector<double> &solution,
+                                moveit_msgs::MoveItErrorCodes &error_code,
+                                const kinematics::KinematicsQueryOptions &options = kinematics::KinematicsQueryOptions()) const;
+
+  virtual bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                                const std::vector<double> &ik_seed_state,
+                                double timeout,
+                                const std::vector<double> &consistency_limits,
+                                std::vector<double> &solution,
+                                moveit_msgs::MoveItErrorCodes &error_code,
+                                const kinematics::KinematicsQueryOptions &options = kinematics::KinematicsQueryOptions()) const;
+
+  virtual bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                                const std::vector<double> &ik_seed_state,
+                                double timeout,
+                                std::vector<double> &solution,
+                                const IKCallbackFn &solution_callback,
+                                moveit_msgs::MoveItErrorCodes &error_code,
+                                const kinematics::KinematicsQueryOptions &options = kinematics::KinematicsQueryOptions()) const;
+
+  virtual bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                                const std::vector<double> &ik_seed_state,
+                                double timeout,
+                                const std::vector<double> &consistency_limits,
+                                std::vector<double> &solution,
+                                const IKCallbackFn &solution_callback,
+                                moveit_msgs::MoveItErrorCodes &error_code,
+                                const kinematics::KinematicsQueryOptions &options = kinematics::KinematicsQueryOptions()) const;
+
+  virtual bool getPositionFK(const std::vector<std::string> &link_names,
+                             const std::vector<double> &joint_angles,
+                             std::vector<geometry_msgs::Pose> &poses) const;
+
+  virtual const std::vector<std::string> &getJointNames() const;
+  virtual const std::vector<std::string> &getLinkNames() const;
+
+ private:
+  bool initGeometry(const std::string &base_frame, const std::string &tip_frame);
+
+  // All branches reaching the pose (at the given pitch when position only), nearest to the seed first
+  int collectSolutions(const geometry_msgs::Pose &ik_pose, const std::vector<double> &ik_seed_state,
+                       double pitch, ChainSolution *solutions) const;
+
+  bool searchSolution(const geometry_msgs::Pose &ik_pose,
+                      const std::vector<double> &ik_seed_state,
+                      double timeout,
+                      const std::vector<double> &consistency_limits,
+                      std::vector<double> &solution,
+                      const IKCallbackFn &solution_callback,
+                      moveit_msgs::MoveItErrorCodes &error_code) const;
+
+  bool checkConsistency(const std::vector<double> &seed_state,
+                        const std::vector<double> &consistency_limits,
+                        const double *solution) const;
+};
+}
+
+#endif /*OPEN_MANIPULATOR_KINEMATICS_PLUGIN_H*/
@@ -0,0 +1,99 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_JERK_LIMITED_TIME_PARAMETERIZATION_H
+#define OPEN_MANIPULATOR_JERK_LIMITED_TIME_PARAMETERIZATION_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace open_manipulator_planning_adapters
+{
+typedef struct
+{
+  double max_velocity;
+  double max_acceleration;
+  double max_jerk;
+} JointLimit;
+
+typedef struct
+{
+  double duration;          // sec
+  double max_jerk_ratio;    // largest |jerk| / max_jerk over all joints, <= 1 when the limits hold
+  int    iterations;
+} TimeParameterizationResult;
+
+/**
+ * @brief Time-optimal timing of a geometric path under joint velocity, acceleration and jerk limits.
+ *
+ * The path is parameterized by its joint space arc length s, with x = (ds/dt)^2 and a constant
+ * path acceleration u = d2s/dt2 between waypoints. The velocity and acceleration limits give the
+ * largest x at each waypoint. A backward pass from the goal and a forward pass from the start then
+ * accelerate as hard as the limits allow, changing u no faster than the jerk limit along the path
+ * and easing off early enough to meet the limit curve ahead. The curvature of the path adds to the
+ * joint jerk, where it exceeds the limit the path jerk is lowered locally and the passes repeated.
+ * The fastest iterate is finally stretched in time until the joint jerk is within its limit.
+ *
+ * Positions, velocities and accelerations are waypoint major (waypoint * joint_num + joint).
+ * The path ends at rest. It starts at rest too, unless a start velocity is set: its component
+ * along the path direction is kept at the first waypoint (within the limits), which lets a
+ * moving arm continue into the new path. Repeated waypoints get the time of the previous one,
+ * JerkLimitedTrajectoryTiming drops them. No ROS dependency.
+ */
+class JerkLimitedTimeParameterization
+{
+ public:
+  JerkLimitedTimeParameterization(int max_iterations = 10, double jerk_tolerance = 0.05);
+
+  void setLimits(const std::vector<JointLimit> &limits) { limits_ = limits; }
+  void setStartVelocity(const std::vector<double> &velocity) { start_velocity_ = velocity; }   // empty = at rest
+
+  bool compute(const std::vector<double> &positions, double velocity_scale, double acceleration_scale,
+               std::vector<double> &time_from_start, std::vector<double> &velocities, std::vector<double> &accelerations,
+               TimeParameterizationResult *result = NULL);
+
+ private:
+  bool initPath(const std::vector<double> &positions);
+  bool getAccelerationRange(size_t node, double x, double *lower, double *upper) const;
+  double getMaxPathVelocitySquared(size_t node) const;
+  double getStartPathVelocitySquared(void) const;
+  bool canMerge(const std::vector<double> &curve, size_t node, double x, double u, double dt, int direction) const;
+  void integrate(int direction, const std::vector<double> &curve, std::vector<double> &x);
+  double updatePathJerk(void);
+  double getSegmentTime(size_t node) const;
+  double getDuration(std::vector<double> *node_time = NULL) const;
+
+  std::vector<JointLimit> limits_;
+  std::vector<JointLimit> scaled_limits_;
+  std::vector<double> start_velocity_;
+  int max_iterations_;
+  double jerk_tolerance_;
+
+  size_t joint_num_;
+  std::vector<size_t> node_index_;   // waypoint -> path node, repeated waypoints share a node
+  std::vector<double> path_;         // node positions, node major
+  std::vector<double> s_;            // arc length of the nodes
+  std::vector<double> dq_;           // dq/ds
+  std::vector<double> ddq_;          // d2q/ds2
+  std::vector<double> path_jerk_;    // largest d3s/dt3 the joint jerk limits allow
+  std::vector<double> x_limit_;      // largest (ds/dt)^2
+  std::vector<double> x_backward_;
+  std::vector<double> x_;
+  std::vector<double> u_;            // d2s/dt2 of the segment after the node
+};
+}
+
+#endif /*OPEN_MANIPULATOR_JERK_LIMITED_TIME_PARAMETERIZATION_H*/
@@ -0,0 +1,84 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_JERK_LIMITED_TRAJECTORY_TIMING_H
+#define OPEN_MANIPULATOR_JERK_LIMITED_TRAJECTORY_TIMING_H
+
+#include <ros/ros.h>
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit_msgs/RobotState.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "open_manipulator_planning_adapters/jerk_limited_time_parameterization.h"
+
+namespace open_manipulator_planning_adapters
+{
+/**
+ * @brief JerkLimitedTimeParameterization on a RobotTrajectory, a drop-in for
+ * trajectory_processing::IterativeParabolicTimeParameterization.
+ *
+ * The active variables of the trajectory group are timed, the durations, velocities and
+ * accelerations of the waypoints are overwritten and repeated waypoints are removed, so no
+ * waypoint is left without a duration. Limits are read once per joint from
+ * robot_description_planning/joint_limits/<joint>/{max_velocity, max_acceleration, max_jerk}
+ * (joint_limits.yaml), the URDF bounds are used when a key is missing.
+ *
+ * ROS parameters (move_group private namespace):
+ * - jerk_limited_timing/max_iterations (default = 10)
+ * - jerk_limited_timing/jerk_tolerance (default = 0.05, relative jerk excess accepted without iterating again)
+ * - jerk_limited_timing/default_max_jerk (default = 5.0 rad/s^3, joints without max_jerk)
+ */
+class JerkLimitedTrajectoryTiming
+{
+ public:
+  JerkLimitedTrajectoryTiming();
+
+  bool computeTimeStamps(robot_trajectory::RobotTrajectory &trajectory,
+                         double max_velocity_scaling_factor = 1.0, double max_acceleration_scaling_factor = 1.0,
+                         TimeParameterizationResult *result = NULL) const;
+
+  /**
+   * @brief Times the trajectory from the joint velocities of the start state (a moving arm)
+   * instead of from rest, see JerkLimitedTimeParameterization::setStartVelocity
+   */
+  bool computeTimeStamps(robot_trajectory::RobotTrajectory &trajectory, const moveit_msgs::RobotState &start_state,
+                         double max_velocity_scaling_factor = 1.0, double max_acceleration_scaling_factor = 1.0,
+                         TimeParameterizationResult *result = NULL) const;
+
+ private:
+  bool computeTimeStamps(robot_trajectory::RobotTrajectory &trajectory, const std::vector<double> &start_velocity,
+                         double max_velocity_scaling_factor, double max_acceleration_scaling_factor,
+                         TimeParameterizationResult *result) const;
+  bool getJointLimits(const robot_model::JointModelGroup *joint_model_group, std::vector<JointLimit> &limits) const;
+
+  ros::NodeHandle nh_;
+  int max_iterations_;
+  double jerk_tolerance_;
+  double default_max_jerk_;
+
+  mutable boost::mutex limits_mutex_;
+  mutable std::map<std::string, JointLimit> limits_;   // variable name -> limit, cached on first use
+};
+}
+
+#endif /*OPEN_MANIPULATOR_JERK_LIMITED_TRAJECTORY_TIMING_H*/
@@ -0,0 +1,280 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <class_loader/class_loader.h>
+
+#include <industrial_trajectory_filters/smoothing_trajectory_filter.h>
+#include <industrial_trajectory_filters/uniform_sample_filter.h>
+#include <open_manipulator_planning_adapters/jerk_limited_trajectory_timing.h>
+#include <ros/ros.h>
+#include <ros/console.h>
+
+#include <vector>
+
+namespace industrial_trajectory_filters
+{
+/**
+ * @brief Smooths, time-parameterizes and uniformly samples the planned trajectory,
+ * replacing the AddSmoothingFilter, AddTimeParameterization and UniformSampleFilter chain.
+ *
+ * The positions are gathered once into a time major matrix and smoothed there. The
+ * path is then retimed on the smoothed positions, so the limits hold for what is
+ * played. Last, the samples are streamed out of the matrix, with velocities and
+ * accelerations differentiated from the smoothed positions and their new times, so
+ * every output waypoint is consistent.
+ *
+ * ROS parameters (move_group private namespace), the same as the separate adapters:
+ * - sample_duration (default = 0.050 sec)
+ * - /move_group/smoothing_filter_name (default coefficients 0.25 0.5 1.0 0.5 0.25)
+ * - /move_group/smoothing_filter_type (default = fir, or savitzky_golay with
+ *   /move_group/savitzky_golay/window and order, default 7 and 3)
+ * - time_parameterization (default = iterative_parabolic, or jerk_limited for the
+ *   JerkLimitedTrajectoryTiming of open_manipulator_planning_adapters, which also keeps
+ *   the joint velocities of the start state of the request)
+ */
+class AddFusedTrajectoryFilter : public planning_request_adapter::PlanningRequestAdapter
+{
+ public:
+  AddFusedTrajectoryFilter() : planning_request_adapter::PlanningRequestAdapter(), nh_("~"), sample_duration_(0.050),
+    is_jerk_limited_(false)
+  {
+    if (!nh_.getParam("sample_duration", sample_duration_))
+      ROS_WARN_STREAM("AddFusedTrajectoryFilter, params has no attribute sample_duration.");
+
+    std::string time_parameterization;
+    nh_.param<std::string>("time_parameterization", time_parameterization, "iterative_parabolic");
+    is_jerk_limited_ = (time_parameterization == "jerk_limited");
+
+    std::vector<double> filter_coef;
+    filter_coef.push_back(0.25);
+    filter_coef.push_back(0.5);
+    filter_coef.push_back(1.0);
+    filter_coef.push_back(0.5);
+    filter_coef.push_back(0.25);
+
+    std::string filter_name;
+    if (nh_.getParam("/move_group/smoothing_filter_name", filter_name))
+    {
+      std::vector<double> temp_coef;
+      nh_.getParam(filter_name, temp_coef);
+
+      if (temp_coef.size() % 2 == 1 && temp_coef.size() > 2)
+        filter_coef = temp_coef;
+      else
+        ROS_INFO_STREAM("Could not read filter, using default filter coefficients");
+    }
+
+    // Only the smoothed positions of a Savitzky-Golay fit are used, the path is retimed after
+    std::string filter_type;
+    nh_.param<std::string>("/move_group/smoothing_filter_type", filter_type, "fir");
+    if (filter_type == "savitzky_golay")
+    {
+      int window, order;
+      nh_.param<int>("/move_group/savitzky_golay/window", window, 7);
+      nh_.param<int>("/move_group/savitzky_golay/order", order, 3);
+
+      if (!smoothing_filter_.initSavitzkyGolay(window, order))
+        ROS_ERROR("Initialization error on Savitzky-Golay filter. Requires an odd window larger than the order, order at least 2");
+    }
+    else if (!smoothing_filter_.init(filter_coef))
+    {
+      ROS_ERROR("Initialization error on smoothing filter. Requires an odd number of coeficients");
+    }
+  }
+
+  virtual std::string getDescription() const { return "Fused Smoothing, Time Parameterization and Uniform Sampling"; }
+
+  virtual bool adaptAndPlan(const PlannerFn &planner,
+                            const planning_scene::PlanningSceneConstPtr &planning_scene,
+                            const planning_interface::MotionPlanRequest &req,
+                            planning_interface::MotionPlanResponse &res,
+                            std::vector<std::size_t> &added_path_index) const
+  {
+    bool result = planner(planning_scene, req, res);
+
+    if (result && res.trajectory_)
+    {
+      ROS_DEBUG("Running '%s'", getDescription().c_str());
+
+      if (!applyFilter(*res.trajectory_, req.start_state, req.max_velocity_scaling_factor, req.max_acceleration_scaling_factor))
+        ROS_ERROR("Fused trajectory filter failed, the trajectory is not filtered");
+    }
+
+    return result;
+  }
+
+ private:
+  typedef SmoothingTrajectoryFilter::WayPointMatrix WayPointMatrix;
+
+  bool applyFilter(robot_trajectory::RobotTrajectory &trajectory, const moveit_msgs::RobotState &start_state,
+                   double max_velocity_scaling_factor, double max_acceleration_scaling_factor) const
+  {
+    const int num_points = trajectory.getWayPointCount();
+    if (num_points < 2)
+      return true;
+
+    const int num_states = trajectory.getWayPoint(0).getVariableCount();
+
+    // Gather once and smooth, the first and last waypoints are kept
+    WayPointMatrix positions(num_points, num_states);
+    for (int j = 0; j < num_points; j++)
+      positions.row(j) = Eigen::Map<const Eigen::RowVectorXd>(trajectory.getWayPoint(j).getVariablePositions(), num_states);
+
+    if (num_points > 2)
+    {
+      smoothing_filter_.applyFilter(positions);
+
+      for (int j = 1; j < num_points - 1; j++)
+        trajectory.getWayPointPtr(j)->setVariablePositions(positions.row(j).data());
+    }
+
+    // Retime the smoothed path, only the durations are used from here on
+    if (is_jerk_limited_)
+    {
+      if (!jerk_limited_timing_.computeTimeStamps(trajectory, start_state, max_velocity_scaling_factor,
+                                                  max_acceleration_scaling_factor))
+        return false;
+    }
+    else if (!time_parameterization_.computeTimeStamps(trajectory, max_velocity_scaling_factor, max_acceleration_scaling_factor))
+    {
+      return false;
+    }
+
+    Eigen::VectorXd time_from_start(num_points);
+    double time = 0.0;
+    for (int j = 0; j < num_points; j++)
+    {
+      time += trajectory.getWayPointDurationFromPrevious(j);
+      time_from_start(j) = time;
+    }
+
+    if (sample_duration_ <= 0.0)
+      return true;
+
+    // The timing may start the path moving (a plan from a moving arm), the samples keep that velocity
+    Eigen::RowVectorXd start_velocity = Eigen::RowVectorXd::Zero(num_states);
+    if (trajectory.getWayPoint(0).hasVelocities() && trajectory.getGroup() != NULL)
+    {
+      const std::vector<int> &variable_index = trajectory.getGroup()->getVariableIndexList();
+      for (std::size_t index = 0; index < variable_index.size(); index++)
+        start_velocity(variable_index[index]) = trajectory.getWayPoint(0).getVariableVelocity(variable_index[index]);
+    }
+
+    // Samples at 0, dt, ... while before the end, then the last waypoint (timed at the next sample)
+    int sample_num = 0;
+    while (sample_num * sample_duration_ < time_from_start(num_points - 1))
+      sample_num++;
+
+    robot_trajectory::RobotTrajectory trajectory_out(trajectory.getRobotModel(), trajectory.getGroupName());
+    robot_state::RobotState sample_state(trajectory.getWayPoint(0));
+
+    Eigen::RowVectorXd velocity1(num_states), acceleration1(num_states);
+    Eigen::RowVectorXd velocity2(num_states), acceleration2(num_states);
+    Eigen::RowVectorXd sample_position(num_states), sample_velocity(num_states), sample_acceleration(num_states);
+    QuinticSegment segment;
+
+    int index = -1;
+    for (int sample = 0; sample < sample_num; sample++)
+    {
+      double sample_time = sample * sample_duration_;
+
+      // Move the cursor, differentiating and fitting only the segments that are reached
+      int next_index = (index < 0) ? 0 : index;
+      while (next_index + 2 < num_points && sample_time > time_from_start(next_index + 1))
+        next_index++;
+
+      if (next_index != index)
+      {
+        index = next_index;
+        differentiate(positions, time_from_start, index, velocity1, acceleration1);
+        differentiate(positions, time_from_start, index + 1, velocity2, acceleration2);
+
+        if (index == 0)
+          velocity1 = start_velocity;
+
+        segment.fit(positions.row(index).data(), velocity1.data(), acceleration1.data(),
+                    positions.row(index + 1).data(), velocity2.data(), acceleration2.data(),
+                    num_states, time_from_start(index + 1) - time_from_start(index));
+      }
+
+      segment.sample(sample_time - time_from_start(index),
+                     sample_position.data(), sample_velocity.data(), sample_acceleration.data());
+
+      sample_state.setVariablePositions(sample_position.data());
+      sample_state.setVariableVelocities(sample_velocity.data());
+      sample_state.setVariableAccelerations(sample_acceleration.data());
+
+      trajectory_out.addSuffixWayPoint(sample_state, (sample == 0) ? 0.0 : sample_duration_);
+    }
+
+    // The path rests at its end
+    sample_position = positions.row(num_points - 1);
+    sample_velocity.setZero();
+    sample_acceleration.setZero();
+
+    sample_state.setVariablePositions(sample_position.data());
+    sample_state.setVariableVelocities(sample_velocity.data());
+    sample_state.setVariableAccelerations(sample_acceleration.data());
+    trajectory_out.addSuffixWayPoint(sample_state, sample_duration_);
+
+    ROS_DEBUG_STREAM("Fused filter, input traj. size: " << num_points << " output traj. size: " << trajectory_out.getWayPointCount());
+
+    trajectory.swap(trajectory_out);
+    return true;
+  }
+
+  /**
+   * @brief Three point derivatives on the non uniform times, zero at both ends of the path
+   */
+  static void differentiate(const WayPointMatrix &positions, const Eigen::VectorXd &time_from_start, int index,
+                            Eigen::RowVectorXd &velocity, Eigen::RowVectorXd &acceleration)
+  {
+    const int num_points = positions.rows();
+
+    velocity.setZero();
+    acceleration.setZero();
+
+    if (index <= 0 || index >= num_points - 1)
+      return;
+
+    const double h0 = time_from_start(index) - time_from_start(index - 1);
+    const double h1 = time_from_start(index + 1) - time_from_start(index);
+
+    if (h0 <= 0.0 || h1 <= 0.0)
+      return;
+
+    const double denominator = h0 * h1 * (h0 + h1);
+
+    velocity = (h0 * h0 * (positions.row(index + 1) - positions.row(index))
+              + h1 * h1 * (positions.row(index) - positions.row(index - 1))) / denominator;
+    acceleration = 2.0 * (h0 * (positions.row(index + 1) - positions.row(index))
+                        - h1 * (positions.row(index) - positions.row(index - 1))) / denominator;
+  }
+
+  ros::NodeHandle nh_;
+  double sample_duration_;
+  SmoothingTrajectoryFilter smoothing_filter_;
+  bool is_jerk_limited_;
+  trajectory_processing::IterativeParabolicTimeParameterization time_parameterization_;
+  open_manipulator_planning_adapters::JerkLimitedTrajectoryTiming jerk_limited_timing_;
+};
+}
+
+CLASS_LOADER_REGISTER_CLASS(industrial_trajectory_filters::AddFusedTrajectoryFilter,
+                            planning_request_adapter::PlanningRequestAdapter);
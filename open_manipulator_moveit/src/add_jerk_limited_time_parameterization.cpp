@@ -0,0 +1,81 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <class_loader/class_loader.h>
+
+#include <ros/ros.h>
+#include <ros/console.h>
+
+#include "open_manipulator_planning_adapters/jerk_limited_trajectory_timing.h"
+
+namespace open_manipulator_planning_adapters
+{
+/**
+ * @brief Time-optimal timing of the planned path under the velocity, acceleration and
+ * jerk limits of joint_limits.yaml, in place of AddTimeParameterization.
+ *
+ * The velocity and acceleration scaling of the request scale the limits, the jerk limit
+ * is scaled with the acceleration. Joint velocities in the start state of the request are
+ * kept, so a plan from a moving arm continues its motion. See JerkLimitedTrajectoryTiming
+ * for the parameters.
+ */
+class AddJerkLimitedTimeParameterization : public planning_request_adapter::PlanningRequestAdapter
+{
+ public:
+  AddJerkLimitedTimeParameterization() : planning_request_adapter::PlanningRequestAdapter()
+  {
+  }
+
+  virtual std::string getDescription() const { return "Add Jerk Limited Time Parameterization"; }
+
+  virtual bool adaptAndPlan(const PlannerFn &planner,
+                            const planning_scene::PlanningSceneConstPtr &planning_scene,
+                            const planning_interface::MotionPlanRequest &req,
+                            planning_interface::MotionPlanResponse &res,
+                            std::vector<std::size_t> &added_path_index) const
+  {
+    bool result = planner(planning_scene, req, res);
+
+    if (result && res.trajectory_)
+    {
+      ROS_DEBUG("Running '%s'", getDescription().c_str());
+
+      TimeParameterizationResult timing;
+      if (!time_parameterization_.computeTimeStamps(*res.trajectory_, req.start_state, req.max_velocity_scaling_factor,
+                                                    req.max_acceleration_scaling_factor, &timing))
+      {
+        ROS_WARN("Jerk limited time parameterization for the solution path failed.");
+        result = false;
+      }
+      else
+      {
+        ROS_DEBUG("Jerk limited timing: %.3f sec, jerk ratio %.3f after %d iterations",
+                  timing.duration, timing.max_jerk_ratio, timing.iterations);
+      }
+    }
+
+    return result;
+  }
+
+ private:
+  JerkLimitedTrajectoryTiming time_parameterization_;
+};
+}
+
+CLASS_LOADER_REGISTER_CLASS(open_manipulator_planning_adapters::AddJerkLimitedTimeParameterization,
+                            planning_request_adapter::PlanningRequestAdapter);
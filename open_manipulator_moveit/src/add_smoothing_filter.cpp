@@ -49,6 +49,8 @@ class AddSmoothingFilter : public planning_request_adapter::PlanningRequestAdapt
 public:
 
   static const std::string FILTER_PARAMETER_NAME_; // base name for filter parameters
+  static const std::string FILTER_TYPE_PARAMETER_NAME_; // fir (coefficients) or savitzky_golay
+  static const std::string SAVITZKY_GOLAY_PARAMETER_NAME_; // namespace of the window and order
 
   /*!  \brief Constructor AddSmoothingFilter is a planning request adapter plugin which post-processes
   *             The robot's trajectory to round out corners
@@ -82,7 +84,17 @@ public:
 	ROS_INFO_STREAM("Could not read filter, using default filter coefficients");
       }
     }
-    if(!smoothing_filter_.init(filter_coef_))
+    // a Savitzky-Golay fit replaces the coefficients, and gives consistent velocities and accelerations
+    std::string filter_type;
+    nh_.param<std::string>(FILTER_TYPE_PARAMETER_NAME_, filter_type, "fir");
+    if(filter_type == "savitzky_golay"){
+      int window, order;
+      nh_.param<int>(SAVITZKY_GOLAY_PARAMETER_NAME_ + "/window", window, 7);
+      nh_.param<int>(SAVITZKY_GOLAY_PARAMETER_NAME_ + "/order", order, 3);
+      if(!smoothing_filter_.initSavitzkyGolay(window, order))
+	ROS_ERROR("Initialization error on Savitzky-Golay filter. Requires an odd window larger than the order, order at least 2");
+    }
+    else if(!smoothing_filter_.init(filter_coef_))
       ROS_ERROR("Initialization error on smoothing filter. Requires an odd number of coeficients");
     
   };
@@ -134,6 +146,8 @@ private:
 };
 
 const std::string  AddSmoothingFilter::FILTER_PARAMETER_NAME_ = "/move_group/smoothing_filter_name";
+const std::string  AddSmoothingFilter::FILTER_TYPE_PARAMETER_NAME_ = "/move_group/smoothing_filter_type";
+const std::string  AddSmoothingFilter::SAVITZKY_GOLAY_PARAMETER_NAME_ = "/move_group/savitzky_golay";
 
 }
 
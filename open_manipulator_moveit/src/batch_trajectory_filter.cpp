@@ -0,0 +1,177 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <industrial_trajectory_filters/batch_trajectory_filter.h>
+
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <ros/ros.h>
+
+#include <boost/bind.hpp>
+
+using namespace industrial_trajectory_filters;
+
+BatchTrajectoryFilter::BatchTrajectoryFilter()
+{
+}
+
+BatchTrajectoryFilter::~BatchTrajectoryFilter()
+{
+  // The adapters have to go before the loader unloads their libraries
+  workers_.clear();
+}
+
+bool BatchTrajectoryFilter::init(const robot_model::RobotModelConstPtr& robot_model,
+                                 const std::vector<std::string>& adapter_names, std::size_t thread_num)
+{
+  robot_model_ = robot_model;
+  workers_.clear();
+
+  if (!adapter_loader_)
+  {
+    try
+    {
+      adapter_loader_.reset(new pluginlib::ClassLoader<planning_request_adapter::PlanningRequestAdapter>(
+                              "moveit_core", "planning_request_adapter::PlanningRequestAdapter"));
+    }
+    catch (pluginlib::PluginlibException& ex)
+    {
+      ROS_ERROR_STREAM("Exception while creating the planning request adapter plugin loader: " << ex.what());
+      return false;
+    }
+  }
+
+  pool_.reset(new WorkStealingPool(thread_num));
+  workers_.resize(pool_->getThreadNum());
+
+  // Constructed one after the other here, the adapters read their parameters on construction
+  for (std::size_t worker = 0; worker < workers_.size(); worker++)
+  {
+    for (std::size_t index = 0; index < adapter_names.size(); index++)
+    {
+      try
+      {
+        workers_[worker].adapters.push_back(planning_request_adapter::PlanningRequestAdapterPtr(
+                                              adapter_loader_->createUnmanagedInstance(adapter_names[index])));
+      }
+      catch (pluginlib::PluginlibException& ex)
+      {
+        ROS_ERROR_STREAM("Failed to load the planning request adapter " << adapter_names[index] << ": " << ex.what());
+        workers_.clear();
+        return false;
+      }
+    }
+
+    workers_[worker].planning_scene.reset(new planning_scene::PlanningScene(robot_model_));
+  }
+
+  return true;
+}
+
+bool BatchTrajectoryFilter::process(const std::vector<moveit_msgs::RobotTrajectory>& trajectories,
+                                    const planning_interface::MotionPlanRequest& req,
+                                    std::vector<moveit_msgs::RobotTrajectory>& filtered,
+                                    std::vector<BatchTrajectoryResult>& results)
+{
+  if (workers_.empty())
+  {
+    ROS_ERROR("BatchTrajectoryFilter is not initialized");
+    return false;
+  }
+
+  if (!robot_model_->hasJointModelGroup(req.group_name))
+  {
+    ROS_ERROR("Unknown group '%s' for the batch trajectory filter", req.group_name.c_str());
+    return false;
+  }
+
+  filtered.resize(trajectories.size());
+  results.resize(trajectories.size());
+
+  // Every task writes its own slots only
+  pool_->run(trajectories.size(),
+             [&](std::size_t index, std::size_t worker)
+             {
+               if (!filterTrajectory(trajectories[index], req, workers_[worker], filtered[index], results[index]))
+                 filtered[index] = trajectories[index];
+             });
+
+  bool success = true;
+  for (std::size_t index = 0; index < results.size(); index++)
+  {
+    if (!results[index].success)
+    {
+      ROS_WARN("Batch trajectory filter failed on trajectory %zu, it is kept unfiltered", index);
+      success = false;
+    }
+  }
+
+  return success;
+}
+
+bool BatchTrajectoryFilter::filterTrajectory(const moveit_msgs::RobotTrajectory& trajectory,
+                                             const planning_interface::MotionPlanRequest& req, Worker& worker,
+                                             moveit_msgs::RobotTrajectory& filtered, BatchTrajectoryResult& result)
+{
+  result.success       = false;
+  result.input_points  = trajectory.joint_trajectory.points.size();
+  result.output_points = 0;
+  result.filter_time   = 0.0;
+
+  robot_state::RobotState reference_state(robot_model_);
+  reference_state.setToDefaultValues();
+
+  robot_trajectory::RobotTrajectoryPtr input(new robot_trajectory::RobotTrajectory(robot_model_, req.group_name));
+  input->setRobotTrajectoryMsg(reference_state, trajectory);
+
+  // The stored trajectory stands in for the planner at the core of the chain
+  const PlannerFn planner = [&input](const planning_scene::PlanningSceneConstPtr&,
+                                     const planning_interface::MotionPlanRequest&,
+                                     planning_interface::MotionPlanResponse& res)
+  {
+    res.trajectory_ = input;
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    return true;
+  };
+
+  planning_interface::MotionPlanResponse res;
+
+  ros::WallTime start_time = ros::WallTime::now();
+  const bool filtered_ok = callAdapter(worker.adapters, 0, planner, worker.planning_scene, req, res);
+  result.filter_time = (ros::WallTime::now() - start_time).toSec();
+
+  if (!filtered_ok || !res.trajectory_)
+    return false;
+
+  res.trajectory_->getRobotTrajectoryMsg(filtered);
+  result.output_points = filtered.joint_trajectory.points.size();
+  result.success = true;
+  return true;
+}
+
+bool BatchTrajectoryFilter::callAdapter(const AdapterChain& adapters, std::size_t index, const PlannerFn& planner,
+                                        const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                        const planning_interface::MotionPlanRequest& req,
+                                        planning_interface::MotionPlanResponse& res)
+{
+  if (index == adapters.size())
+    return planner(planning_scene, req, res);
+
+  std::vector<std::size_t> added_path_index;
+  return adapters[index]->adaptAndPlan(boost::bind(&BatchTrajectoryFilter::callAdapter, boost::cref(adapters), index + 1,
+                                                   boost::cref(planner), _1, _2, _3),
+                                       planning_scene, req, res, added_path_index);
+}
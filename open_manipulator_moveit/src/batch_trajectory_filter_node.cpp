@@ -0,0 +1,201 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Filters every trajectory of a bag with a pipeline of planning request adapters on all
+// cores, and writes them to a new bag under the same topics and times. Both
+// moveit_msgs/RobotTrajectory and moveit_msgs/DisplayTrajectory messages (as recorded from
+// /move_group/display_planned_path) are filtered, other messages are copied.
+//
+// ROS parameters (private):
+// - input_bag, output_bag (required)
+// - request_adapters (default = industrial_trajectory_filters/AddFusedTrajectoryFilter)
+// - group (default = arm)
+// - threads (default = 0, one per core)
+// - velocity_scale, acceleration_scale (default = 1.0)
+// - the parameters of the adapters, as for move_group
+
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit_msgs/DisplayTrajectory.h>
+#include <moveit_msgs/RobotTrajectory.h>
+
+#include <industrial_trajectory_filters/batch_trajectory_filter.h>
+
+#include <boost/foreach.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef struct
+{
+  std::size_t message;          // index of the message in the bag
+  std::size_t trajectory;       // index of the trajectory in a DisplayTrajectory
+} TrajectorySource;
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "batch_trajectory_filter");
+  ros::NodeHandle priv_nh("~");
+
+  std::string input_bag_name, output_bag_name;
+  if (!priv_nh.getParam("input_bag", input_bag_name) || !priv_nh.getParam("output_bag", output_bag_name))
+  {
+    ROS_ERROR("Batch trajectory filter needs the input_bag and output_bag parameters");
+    return 1;
+  }
+
+  std::string request_adapters = priv_nh.param<std::string>("request_adapters",
+                                                             "industrial_trajectory_filters/AddFusedTrajectoryFilter");
+  int threads = priv_nh.param<int>("threads", 0);
+
+  planning_interface::MotionPlanRequest req;
+  req.group_name = priv_nh.param<std::string>("group", "arm");
+  req.max_velocity_scaling_factor = priv_nh.param<double>("velocity_scale", 1.0);
+  req.max_acceleration_scaling_factor = priv_nh.param<double>("acceleration_scale", 1.0);
+
+  // Whitespace separated, like the request_adapters of move_group
+  std::vector<std::string> adapter_names;
+  std::istringstream adapter_stream(request_adapters);
+  std::string adapter_name;
+  while (adapter_stream >> adapter_name)
+    adapter_names.push_back(adapter_name);
+
+  robot_model_loader::RobotModelLoader robot_model_loader("robot_description", false);
+  robot_model::RobotModelPtr robot_model = robot_model_loader.getModel();
+
+  if (!robot_model)
+  {
+    ROS_ERROR("Robot model is not loaded");
+    return 1;
+  }
+
+  industrial_trajectory_filters::BatchTrajectoryFilter batch_filter;
+  if (!batch_filter.init(robot_model, adapter_names, threads < 0 ? 0 : threads))
+    return 1;
+
+  // Read the whole bag, the trajectories are filtered together
+  rosbag::Bag input_bag;
+  std::vector<rosbag::MessageInstance> messages;
+  std::vector<moveit_msgs::DisplayTrajectory::ConstPtr> display_trajectories;
+  std::vector<moveit_msgs::RobotTrajectory> trajectories;
+  std::vector<TrajectorySource> sources;
+
+  try
+  {
+    input_bag.open(input_bag_name, rosbag::bagmode::Read);
+    rosbag::View view(input_bag);
+
+    BOOST_FOREACH(const rosbag::MessageInstance &message, view)
+    {
+      TrajectorySource source = {messages.size(), 0};
+      display_trajectories.push_back(moveit_msgs::DisplayTrajectory::ConstPtr());
+      messages.push_back(message);
+
+      moveit_msgs::RobotTrajectory::ConstPtr trajectory = message.instantiate<moveit_msgs::RobotTrajectory>();
+      if (trajectory)
+      {
+        trajectories.push_back(*trajectory);
+        sources.push_back(source);
+        continue;
+      }
+
+      display_trajectories.back() = message.instantiate<moveit_msgs::DisplayTrajectory>();
+      if (!display_trajectories.back())
+        continue;
+
+      for (source.trajectory = 0; source.trajectory < display_trajectories.back()->trajectory.size(); source.trajectory++)
+      {
+        trajectories.push_back(display_trajectories.back()->trajectory[source.trajectory]);
+        sources.push_back(source);
+      }
+    }
+  }
+  catch (rosbag::BagException &ex)
+  {
+    ROS_ERROR("Failed to read %s: %s", input_bag_name.c_str(), ex.what());
+    return 1;
+  }
+
+  ROS_INFO("Batch trajectory filter: %zu trajectories of %zu messages, %zu adapters on %zu threads",
+           trajectories.size(), messages.size(), adapter_names.size(), batch_filter.getThreadNum());
+
+  std::vector<moveit_msgs::RobotTrajectory> filtered;
+  std::vector<industrial_trajectory_filters::BatchTrajectoryResult> results;
+
+  ros::WallTime start_time = ros::WallTime::now();
+  const bool success = batch_filter.process(trajectories, req, filtered, results);
+  const double process_time = (ros::WallTime::now() - start_time).toSec();
+
+  // Put the filtered trajectories back into their display messages
+  std::vector<moveit_msgs::DisplayTrajectory> filtered_displays(messages.size());
+  for (std::size_t index = 0; index < messages.size(); index++)
+  {
+    if (display_trajectories[index])
+      filtered_displays[index] = *display_trajectories[index];
+  }
+
+  std::size_t input_points = 0, output_points = 0;
+  double filter_time = 0.0;
+
+  for (std::size_t index = 0; index < results.size(); index++)
+  {
+    input_points  += results[index].input_points;
+    output_points += results[index].output_points;
+    filter_time   += results[index].filter_time;
+
+    if (display_trajectories[sources[index].message])
+      filtered_displays[sources[index].message].trajectory[sources[index].trajectory] = filtered[index];
+  }
+
+  try
+  {
+    rosbag::Bag output_bag;
+    output_bag.open(output_bag_name, rosbag::bagmode::Write);
+
+    std::size_t trajectory = 0;
+    for (std::size_t index = 0; index < messages.size(); index++)
+    {
+      const rosbag::MessageInstance &message = messages[index];
+
+      if (trajectory < sources.size() && sources[trajectory].message == index && !display_trajectories[index])
+        output_bag.write(message.getTopic(), message.getTime(), filtered[trajectory++]);
+      else if (display_trajectories[index])
+        output_bag.write(message.getTopic(), message.getTime(), filtered_displays[index]);
+      else
+        output_bag.write(message.getTopic(), message.getTime(), message, message.getConnectionHeader());
+
+      // Skip the trajectories of this display message
+      while (trajectory < sources.size() && sources[trajectory].message == index)
+        trajectory++;
+    }
+
+    output_bag.close();
+  }
+  catch (rosbag::BagException &ex)
+  {
+    ROS_ERROR("Failed to write %s: %s", output_bag_name.c_str(), ex.what());
+    return 1;
+  }
+
+  ROS_INFO("Filtered %zu trajectories (%zu -> %zu points) in %.3f sec, %.3f sec of filtering, written to %s",
+           trajectories.size(), input_points, output_points, process_time, filter_time, output_bag_name.c_str());
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_kinematics/chain_ik_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+using namespace open_manipulator_kinematics;
+
+// Planar vectors are handled as complex numbers (radial + i * height).
+// A pitch rotation by angle q about the y axis is then a multiplication by exp(-i * q).
+typedef std::complex<double> Planar;
+
+static const double SINGULAR_REACH = 1e-9;     // target on the joint1 axis
+static const double LIMIT_MARGIN   = 1e-9;     // rounding allowance at the joint limits
+
+static Planar pitchRotation(double angle)
+{
+  return std::polar(1.0, -angle);
+}
+
+static double normalizeAngle(double angle)
+{
+  angle = std::fmod(angle + M_PI, 2.0 * M_PI);
+  if (angle <= 0.0)
+    angle += 2.0 * M_PI;
+  return angle - M_PI;
+}
+
+ChainIKSolver::ChainIKSolver()
+    :orientation_tolerance_(1e-3)
+{
+  ChainGeometry geometry = {};
+  geometry_ = geometry;
+
+  for (int index = 0; index < CHAIN_JOINT_NUM; index++)
+  {
+    lower_limit_[index] = -M_PI;
+    upper_limit_[index] =  M_PI;
+  }
+}
+
+void ChainIKSolver::setGeometry(const ChainGeometry &geometry)
+{
+  geometry_ = geometry;
+}
+
+void ChainIKSolver::setJointLimits(const double *lower, const double *upper)
+{
+  for (int index = 0; index < CHAIN_JOINT_NUM; index++)
+  {
+    lower_limit_[index] = lower[index];
+    upper_limit_[index] = upper[index];
+  }
+}
+
+void ChainIKSolver::setOrientationTolerance(double tolerance)
+{
+  orientation_tolerance_ = tolerance;
+}
+
+void ChainIKSolver::forward(const double *position, Eigen::Vector3d &tip_position, double &pitch) const
+{
+  const Planar shoulder(geometry_.shoulder_x, geometry_.shoulder_z);
+  const Planar upper_arm(geometry_.upper_arm_x, geometry_.upper_arm_z);
+  const Planar forearm(geometry_.forearm_x, geometry_.forearm_z);
+  const Planar tip(geometry_.tip_x, geometry_.tip_z);
+
+  pitch = position[1] + position[2] + position[3];
+
+  const Planar planar = shoulder
+                      + upper_arm * pitchRotation(position[1])
+                      + forearm   * pitchRotation(position[1] + position[2])
+                      + tip       * pitchRotation(pitch);
+
+  tip_position.x() = geometry_.yaw_axis_x + planar.real() * std::cos(position[0]);
+  tip_position.y() = geometry_.yaw_axis_y + planar.real() * std::sin(position[0]);
+  tip_position.z() = planar.imag();
+}
+
+void ChainIKSolver::forward(const double *position, Eigen::Vector3d &tip_position, Eigen::Matrix3d &tip_orientation) const
+{
+  double pitch = 0.0;
+  forward(position, tip_position, pitch);
+
+  tip_orientation = Eigen::AngleAxisd(position[0], Eigen::Vector3d::UnitZ())
+                  * Eigen::AngleAxisd(pitch, Eigen::Vector3d::UnitY());
+}
+
+int ChainIKSolver::solve(const Eigen::Vector3d &tip_position, double pitch, double seed_yaw,
+                         ChainSolution *solutions) const
+{
+  const double dx = tip_position.x() - geometry_.yaw_axis_x;
+  const double dy = tip_position.y() - geometry_.yaw_axis_y;
+  const double reach = std::sqrt(dx * dx + dy * dy);
+  const double yaw = (reach < SINGULAR_REACH) ? seed_yaw : std::atan2(dy, dx);
+
+  int count = 0;
+  count += solveBranch(yaw, reach, tip_position.z(), pitch, solutions + count);
+  count += solveBranch(yaw + M_PI, -reach, tip_position.z(), pitch, solutions + count);
+
+  return count;
+}
+
+int ChainIKSolver::solve(const Eigen::Vector3d &tip_position, const Eigen::Matrix3d &tip_orientation, double seed_yaw,
+                         ChainSolution *solutions) const
+{
+  const double dx = tip_position.x() - geometry_.yaw_axis_x;
+  const double dy = tip_position.y() - geometry_.yaw_axis_y;
+  const double reach = std::sqrt(dx * dx + dy * dy);
+  const double yaw = (reach < SINGULAR_REACH) ? seed_yaw : std::atan2(dy, dx);
+
+  const Eigen::Vector3d tip_x_axis = tip_orientation.col(0);
+
+  int count = 0;
+
+  for (int branch = 0; branch < 2; branch++)
+  {
+    const double branch_yaw    = (branch == 0) ? yaw : yaw + M_PI;
+    const double branch_radial = (branch == 0) ? reach : -reach;
+
+    // The reachable orientations are Rz(yaw) * Ry(pitch); take the pitch that points the tip x axis
+    // where the target does and reject the branch if roll or yaw of the target can not be matched
+    const double pitch = std::atan2(-tip_x_axis.z(),
+                                    tip_x_axis.x() * std::cos(branch_yaw) + tip_x_axis.y() * std::sin(branch_yaw));
+
+    const Eigen::Matrix3d reachable = Eigen::Matrix3d(Eigen::AngleAxisd(branch_yaw, Eigen::Vector3d::UnitZ())
+                                                    * Eigen::AngleAxisd(pitch, Eigen::Vector3d::UnitY()));
+
+    if (Eigen::AngleAxisd(reachable.transpose() * tip_orientation).angle() > orientation_tolerance_)
+      continue;
+
+    count += solveBranch(branch_yaw, branch_radial, tip_position.z(), pitch, solutions + count);
+  }
+
+  return count;
+}
+
+int ChainIKSolver::solveBranch(double yaw, double radial, double height, double pitch, ChainSolution *solutions) const
+{
+  const Planar shoulder(geometry_.shoulder_x, geometry_.shoulder_z);
+  const Planar upper_arm(geometry_.upper_arm_x, geometry_.upper_arm_z);
+  const Planar forearm(geometry_.forearm_x, geometry_.forearm_z);
+  const Planar tip(geometry_.tip_x, geometry_.tip_z);
+
+  // joint4 position relative to joint2
+  const Planar wrist = Planar(radial, height) - shoulder - tip * pitchRotation(pitch);
+
+  // |wrist|^2 = |upper_arm|^2 + |forearm|^2 + 2 |m| cos(arg(m) - joint3)
+  const Planar m = std::conj(upper_arm) * forearm;
+  double cos_elbow = (std::norm(wrist) - std::norm(upper_arm) - std::norm(forearm)) / (2.0 * std::abs(m));
+
+  if (cos_elbow > 1.0 + LIMIT_MARGIN || cos_elbow < -1.0 - LIMIT_MARGIN)
+    return 0;
+
+  cos_elbow = std::max(-1.0, std::min(1.0, cos_elbow));
+
+  const double elbow = std::acos(cos_elbow);
+  const int elbow_branches = (elbow < LIMIT_MARGIN) ? 1 : 2;
+
+  int count = 0;
+
+  for (int branch = 0; branch < elbow_branches; branch++)
+  {
+    double position[CHAIN_JOINT_NUM];
+
+    position[0] = yaw;
+    position[2] = std::arg(m) + ((branch == 0) ? -elbow : elbow);
+    position[1] = std::arg(upper_arm + forearm * pitchRotation(position[2])) - std::arg(wrist);
+    position[3] = pitch - position[1] - position[2];
+
+    bool valid = true;
+    for (int index = 0; index < CHAIN_JOINT_NUM && valid; index++)
+      valid = fitToLimits(index, position[index]);
+
+    if (valid == false)
+      continue;
+
+    for (int index = 0; index < CHAIN_JOINT_NUM; index++)
+      solutions[count].position[index] = position[index];
+    count++;
+  }
+
+  return count;
+}
+
+bool ChainIKSolver::withinLimits(const double *position) const
+{
+  for (int index = 0; index < CHAIN_JOINT_NUM; index++)
+  {
+    if (position[index] < lower_limit_[index] - LIMIT_MARGIN || position[index] > upper_limit_[index] + LIMIT_MARGIN)
+      return false;
+  }
+  return true;
+}
+
+bool ChainIKSolver::fitToLimits(int joint, double &position) const
+{
+  position = normalizeAngle(position);
+
+  if (position < lower_limit_[joint] - LIMIT_MARGIN)
+    position += 2.0 * M_PI;
+  else if (position > upper_limit_[joint] + LIMIT_MARGIN)
+    position -= 2.0 * M_PI;
+
+  if (position < lower_limit_[joint] - LIMIT_MARGIN || position > upper_limit_[joint] + LIMIT_MARGIN)
+    return false;
+
+  position = std::max(lower_limit_[joint], std::min(upper_limit_[joint], position));
+  return true;
+}
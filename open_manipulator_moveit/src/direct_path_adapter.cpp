@@ -0,0 +1,335 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <class_loader/class_loader.h>
+
+#include <ros/ros.h>
+#include <ros/console.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+namespace open_manipulator_planning_adapters
+{
+/**
+ * @brief Tries the straight path to the goal before calling the planner.
+ *
+ * Joint goals are interpolated linearly in joint space, pose goals along the
+ * straight Cartesian line of the goal link. If every state along the path is
+ * valid at the configured resolution, the time-parameterized path is returned
+ * and the nested planner (OMPL) is not called at all.
+ *
+ * Put it last in the adapter list so that the Fix* adapters run before it and
+ * the trajectory filters still process its result.
+ *
+ * ROS parameters (move_group private namespace):
+ * - direct_path/joint_resolution (default = 0.05 rad, largest joint step between checked states)
+ * - direct_path/cartesian_resolution (default = 0.005 m)
+ * - direct_path/max_joint_jump (default = 0.2 rad, per Cartesian step)
+ * - direct_path/ik_timeout (default = 0.005 sec)
+ * - direct_path/stats_window (default = 200 requests per route)
+ * - direct_path/stats_period (default = 60 sec between summaries at INFO, 0 = never)
+ *
+ * Every request is logged at DEBUG, raise the logger level of move_group to see them.
+ */
+class DirectPathAdapter : public planning_request_adapter::PlanningRequestAdapter
+{
+ public:
+  DirectPathAdapter() : planning_request_adapter::PlanningRequestAdapter(), nh_("~"),
+    direct_count_(0), fallback_count_(0), last_summary_time_(ros::WallTime::now())
+  {
+    nh_.param<double>("direct_path/joint_resolution",     joint_resolution_,     0.05);
+    nh_.param<double>("direct_path/cartesian_resolution", cartesian_resolution_, 0.005);
+    nh_.param<double>("direct_path/max_joint_jump",       max_joint_jump_,       0.2);
+    nh_.param<double>("direct_path/ik_timeout",           ik_timeout_,           0.005);
+    nh_.param<int>("direct_path/stats_window",            stats_window_,         200);
+    nh_.param<double>("direct_path/stats_period",         stats_period_,         60.0);
+  }
+
+  virtual std::string getDescription() const { return "Direct Path Fast Check"; }
+
+  virtual bool adaptAndPlan(const PlannerFn &planner,
+                            const planning_scene::PlanningSceneConstPtr &planning_scene,
+                            const planning_interface::MotionPlanRequest &req,
+                            planning_interface::MotionPlanResponse &res,
+                            std::vector<std::size_t> &added_path_index) const
+  {
+    ros::WallTime start_time = ros::WallTime::now();
+
+    if (planDirectPath(planning_scene, req, res))
+    {
+      res.planning_time_ = (ros::WallTime::now() - start_time).toSec();
+      updateStats(true, res.planning_time_);
+      return true;
+    }
+
+    bool result = planner(planning_scene, req, res);
+
+    updateStats(false, (ros::WallTime::now() - start_time).toSec());
+    return result;
+  }
+
+ private:
+  typedef std::deque<double> LatencyWindow;
+
+  bool planDirectPath(const planning_scene::PlanningSceneConstPtr &planning_scene,
+                      const planning_interface::MotionPlanRequest &req,
+                      planning_interface::MotionPlanResponse &res) const
+  {
+    const robot_model::JointModelGroup *joint_model_group = planning_scene->getRobotModel()->getJointModelGroup(req.group_name);
+
+    if (joint_model_group == NULL)
+      return false;
+
+    robot_state::RobotStatePtr start_state = planning_scene->getCurrentStateUpdated(req.start_state);
+    start_state->update();
+
+    if (planning_scene->isStateValid(*start_state, req.path_constraints, req.group_name) == false)
+      return false;
+
+    for (std::size_t goal_num = 0; goal_num < req.goal_constraints.size(); goal_num++)
+    {
+      const moveit_msgs::Constraints &goal = req.goal_constraints[goal_num];
+
+      kinematic_constraints::KinematicConstraintSet goal_constraint_set(planning_scene->getRobotModel());
+      goal_constraint_set.add(goal, planning_scene->getTransforms());
+
+      robot_trajectory::RobotTrajectoryPtr trajectory(new robot_trajectory::RobotTrajectory(planning_scene->getRobotModel(), req.group_name));
+      bool is_valid = false;
+
+      if (goal.position_constraints.empty() && goal.orientation_constraints.empty() && !goal.joint_constraints.empty())
+        is_valid = calcJointPath(planning_scene, req, joint_model_group, *start_state, goal, *trajectory);
+      else if (goal.position_constraints.size() == 1 && goal.joint_constraints.empty())
+        is_valid = calcCartesianPath(planning_scene, req, joint_model_group, *start_state, goal, *trajectory);
+
+      if (is_valid == false || trajectory->empty())
+        continue;
+
+      if (goal_constraint_set.decide(trajectory->getLastWayPoint()).satisfied == false)
+        continue;
+
+      // An untimed path must not reach the controller, the planner gets the request instead
+      trajectory_processing::IterativeParabolicTimeParameterization time_parameterization;
+      if (time_parameterization.computeTimeStamps(*trajectory, req.max_velocity_scaling_factor,
+                                                  req.max_acceleration_scaling_factor) == false)
+        continue;
+
+      res.trajectory_ = trajectory;
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+
+      return true;
+    }
+
+    return false;
+  }
+
+  bool calcJointPath(const planning_scene::PlanningSceneConstPtr &planning_scene,
+                     const planning_interface::MotionPlanRequest &req,
+                     const robot_model::JointModelGroup *joint_model_group,
+                     const robot_state::RobotState &start_state,
+                     const moveit_msgs::Constraints &goal,
+                     robot_trajectory::RobotTrajectory &trajectory) const
+  {
+    robot_state::RobotState goal_state(start_state);
+
+    for (std::size_t index = 0; index < goal.joint_constraints.size(); index++)
+    {
+      const moveit_msgs::JointConstraint &joint_constraint = goal.joint_constraints[index];
+
+      if (goal_state.getRobotModel()->hasJointModel(joint_constraint.joint_name) == false)
+        return false;
+
+      goal_state.setVariablePosition(joint_constraint.joint_name, joint_constraint.position);
+    }
+
+    goal_state.enforceBounds(joint_model_group);
+    goal_state.update();
+
+    const double distance = calcMaxJointDistance(joint_model_group, start_state, goal_state);
+    const int steps = std::max(1, (int)std::ceil(distance / joint_resolution_));
+
+    robot_state::RobotState state(start_state);
+
+    for (int step = 0; step <= steps; step++)
+    {
+      start_state.interpolate(goal_state, (double)step / steps, state, joint_model_group);
+      state.update();
+
+      if (planning_scene->isStateValid(state, req.path_constraints, req.group_name) == false)
+        return false;
+
+      trajectory.addSuffixWayPoint(state, 0.0);
+    }
+
+    return true;
+  }
+
+  bool calcCartesianPath(const planning_scene::PlanningSceneConstPtr &planning_scene,
+                         const planning_interface::MotionPlanRequest &req,
+                         const robot_model::JointModelGroup *joint_model_group,
+                         const robot_state::RobotState &start_state,
+                         const moveit_msgs::Constraints &goal,
+                         robot_trajectory::RobotTrajectory &trajectory) const
+  {
+    const moveit_msgs::PositionConstraint &position_constraint = goal.position_constraints[0];
+
+    if (position_constraint.constraint_region.primitive_poses.empty() ||
+        start_state.getRobotModel()->hasLinkModel(position_constraint.link_name) == false)
+      return false;
+
+    const robot_model::LinkModel *link_model = start_state.getLinkModel(position_constraint.link_name);
+
+    // Goal link pose in the model frame
+    const Eigen::Affine3d &start_pose = start_state.getGlobalLinkTransform(link_model);
+    const Eigen::Affine3d &goal_frame = planning_scene->getFrameTransform(position_constraint.header.frame_id);
+
+    const geometry_msgs::Point &goal_point = position_constraint.constraint_region.primitive_poses[0].position;
+    const Eigen::Vector3d goal_position = goal_frame * Eigen::Vector3d(goal_point.x, goal_point.y, goal_point.z);
+
+    Eigen::Quaterniond start_orientation(start_pose.rotation());
+    Eigen::Quaterniond goal_orientation(start_orientation);
+
+    for (std::size_t index = 0; index < goal.orientation_constraints.size(); index++)
+    {
+      const moveit_msgs::OrientationConstraint &orientation_constraint = goal.orientation_constraints[index];
+
+      if (orientation_constraint.link_name != position_constraint.link_name)
+        return false;
+
+      const Eigen::Affine3d &frame = planning_scene->getFrameTransform(orientation_constraint.header.frame_id);
+      goal_orientation = Eigen::Quaterniond(frame.rotation()) *
+                         Eigen::Quaterniond(orientation_constraint.orientation.w, orientation_constraint.orientation.x,
+                                            orientation_constraint.orientation.y, orientation_constraint.orientation.z);
+    }
+
+    const double distance = (goal_position - start_pose.translation()).norm();
+    const int steps = std::max(1, (int)std::ceil(distance / cartesian_resolution_));
+
+    robot_state::RobotState state(start_state);
+    robot_state::RobotState previous_state(start_state);
+
+    trajectory.addSuffixWayPoint(start_state, 0.0);
+
+    for (int step = 1; step <= steps; step++)
+    {
+      const double ratio = (double)step / steps;
+
+      Eigen::Affine3d pose = Eigen::Translation3d(start_pose.translation() + ratio * (goal_position - start_pose.translation())) *
+                             start_orientation.slerp(ratio, goal_orientation);
+
+      // Seeded with the previous waypoint, so the IK stays on the same branch
+      if (state.setFromIK(joint_model_group, pose, position_constraint.link_name, 1, ik_timeout_) == false)
+        return false;
+
+      state.update();
+
+      if (calcMaxJointDistance(joint_model_group, previous_state, state) > max_joint_jump_)
+        return false;
+
+      if (planning_scene->isStateValid(state, req.path_constraints, req.group_name) == false)
+        return false;
+
+      trajectory.addSuffixWayPoint(state, 0.0);
+      previous_state = state;
+    }
+
+    return true;
+  }
+
+  static double calcMaxJointDistance(const robot_model::JointModelGroup *joint_model_group,
+                                     const robot_state::RobotState &from,
+                                     const robot_state::RobotState &to)
+  {
+    const std::vector<const robot_model::JointModel*> &joint_models = joint_model_group->getActiveJointModels();
+    double distance = 0.0;
+
+    for (std::size_t index = 0; index < joint_models.size(); index++)
+      distance = std::max(distance, from.distance(to, joint_models[index]));
+
+    return distance;
+  }
+
+  void updateStats(bool is_direct, double latency) const
+  {
+    boost::mutex::scoped_lock lock(stats_mutex_);
+
+    LatencyWindow &window = is_direct ? direct_latency_ : fallback_latency_;
+    window.push_back(latency);
+    if ((int)window.size() > stats_window_)
+      window.pop_front();
+
+    if (is_direct)
+      direct_count_++;
+    else
+      fallback_count_++;
+
+    const unsigned int total = direct_count_ + fallback_count_;
+
+    ROS_DEBUG("Direct path %s: %u / %u requests (%.1f %%), median latency direct %.2f ms, planner %.2f ms",
+              is_direct ? "used" : "not valid, planner called",
+              direct_count_, total, 100.0 * direct_count_ / total,
+              1000.0 * calcMedian(direct_latency_), 1000.0 * calcMedian(fallback_latency_));
+
+    const ros::WallTime now = ros::WallTime::now();
+    if (stats_period_ <= 0.0 || (now - last_summary_time_).toSec() < stats_period_)
+      return;
+
+    last_summary_time_ = now;
+    ROS_INFO("Direct path used for %u / %u requests (%.1f %%), median latency direct %.2f ms, planner %.2f ms",
+             direct_count_, total, 100.0 * direct_count_ / total,
+             1000.0 * calcMedian(direct_latency_), 1000.0 * calcMedian(fallback_latency_));
+  }
+
+  static double calcMedian(const LatencyWindow &window)
+  {
+    if (window.empty())
+      return 0.0;
+
+    std::vector<double> samples(window.begin(), window.end());
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+
+    return samples[samples.size() / 2];
+  }
+
+  ros::NodeHandle nh_;
+
+  double joint_resolution_;
+  double cartesian_resolution_;
+  double max_joint_jump_;
+  double ik_timeout_;
+  int stats_window_;
+  double stats_period_;
+
+  mutable boost::mutex stats_mutex_;
+  mutable unsigned int direct_count_;
+  mutable unsigned int fallback_count_;
+  mutable LatencyWindow direct_latency_;
+  mutable LatencyWindow fallback_latency_;
+  mutable ros::WallTime last_summary_time_;
+};
+}
+
+CLASS_LOADER_REGISTER_CLASS(open_manipulator_planning_adapters::DirectPathAdapter,
+                            planning_request_adapter::PlanningRequestAdapter);
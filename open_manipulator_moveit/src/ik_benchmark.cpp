@@ -0,0 +1,170 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Compares kinematics plugins on random reachable poses of the arm group.
+//
+// ROS parameters (private):
+// - samples (default = 1000000)
+// - timeout (default = 0.005 sec)
+// - solvers (default = [kdl_kinematics_plugin/KDLKinematicsPlugin,
+//                       open_manipulator_kinematics/OpenManipulatorKinematicsPlugin])
+
+#include <ros/ros.h>
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/kinematics_base/kinematics_base.h>
+
+#include <pluginlib/class_loader.h>
+#include <random_numbers/random_numbers.h>
+
+#include <algorithm>
+#include <vector>
+#include <string>
+
+typedef struct
+{
+  uint32_t success;
+  uint32_t pose_error;
+  double   solve_time;       // sec
+  double   max_position_error;
+} BenchmarkResult;
+
+static geometry_msgs::Pose toPoseMsg(const Eigen::Affine3d &pose)
+{
+  geometry_msgs::Pose msg;
+  const Eigen::Quaterniond quaternion(pose.rotation());
+
+  msg.position.x    = pose.translation().x();
+  msg.position.y    = pose.translation().y();
+  msg.position.z    = pose.translation().z();
+  msg.orientation.x = quaternion.x();
+  msg.orientation.y = quaternion.y();
+  msg.orientation.z = quaternion.z();
+  msg.orientation.w = quaternion.w();
+
+  return msg;
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "open_manipulator_ik_benchmark");
+  ros::NodeHandle priv_nh("~");
+
+  int samples = priv_nh.param<int>("samples", 1000000);
+  double timeout = priv_nh.param<double>("timeout", 0.005);
+  std::string group_name = priv_nh.param<std::string>("group", "arm");
+
+  std::vector<std::string> solver_names;
+  if (!priv_nh.getParam("solvers", solver_names))
+  {
+    solver_names.push_back("kdl_kinematics_plugin/KDLKinematicsPlugin");
+    solver_names.push_back("open_manipulator_kinematics/OpenManipulatorKinematicsPlugin");
+  }
+
+  robot_model_loader::RobotModelLoader robot_model_loader("robot_description", false);
+  robot_model::RobotModelPtr robot_model = robot_model_loader.getModel();
+
+  if (!robot_model)
+  {
+    ROS_ERROR("Robot model is not loaded");
+    return 1;
+  }
+
+  const robot_model::JointModelGroup *joint_model_group = robot_model->getJointModelGroup(group_name);
+  const std::string &base_frame = joint_model_group->getLinkModelNames().front();
+  const std::string &tip_frame  = joint_model_group->getLinkModelNames().back();
+
+  pluginlib::ClassLoader<kinematics::KinematicsBase> kinematics_loader("moveit_core", "kinematics::KinematicsBase");
+  std::vector<kinematics::KinematicsBasePtr> solvers;
+
+  for (std::size_t index = 0; index < solver_names.size(); index++)
+  {
+    kinematics::KinematicsBasePtr solver(kinematics_loader.createUnmanagedInstance(solver_names[index]));
+
+    if (!solver->initialize("robot_description", group_name, base_frame, tip_frame, 0.005))
+    {
+      ROS_ERROR("Failed to initialize %s", solver_names[index].c_str());
+      return 1;
+    }
+    solvers.push_back(solver);
+  }
+
+  // Random reachable targets (FK of random joint positions) and random seeds, same for every solver
+  random_numbers::RandomNumberGenerator rng(0);
+  robot_state::RobotState state(robot_model);
+  state.setToDefaultValues();
+
+  std::vector<geometry_msgs::Pose> targets(samples);
+  std::vector<std::vector<double> > seeds(samples);
+
+  for (int sample = 0; sample < samples; sample++)
+  {
+    state.setToRandomPositions(joint_model_group, rng);
+    state.update();
+    targets[sample] = toPoseMsg(state.getGlobalLinkTransform(base_frame).inverse() * state.getGlobalLinkTransform(tip_frame));
+
+    state.setToRandomPositions(joint_model_group, rng);
+    state.copyJointGroupPositions(joint_model_group, seeds[sample]);
+  }
+
+  ROS_INFO("IK benchmark: %d samples, group '%s' (%s -> %s), timeout %.3f sec",
+           samples, group_name.c_str(), base_frame.c_str(), tip_frame.c_str(), timeout);
+
+  for (std::size_t index = 0; index < solvers.size(); index++)
+  {
+    BenchmarkResult result = {0, 0, 0.0, 0.0};
+    std::vector<double> solution;
+
+    for (int sample = 0; sample < samples; sample++)
+    {
+      moveit_msgs::MoveItErrorCodes error_code;
+
+      ros::WallTime start_time = ros::WallTime::now();
+      bool solved = solvers[index]->searchPositionIK(targets[sample], seeds[sample], timeout, solution, error_code);
+      result.solve_time += (ros::WallTime::now() - start_time).toSec();
+
+      if (!solved)
+        continue;
+
+      result.success++;
+
+      // Verify the solution with the robot model rather than the solver's own FK
+      state.setJointGroupPositions(joint_model_group, solution);
+      state.update();
+      const Eigen::Vector3d position = (state.getGlobalLinkTransform(base_frame).inverse() *
+                                        state.getGlobalLinkTransform(tip_frame)).translation();
+      const double position_error = (position - Eigen::Vector3d(targets[sample].position.x,
+                                                                targets[sample].position.y,
+                                                                targets[sample].position.z)).norm();
+
+      result.max_position_error = std::max(result.max_position_error, position_error);
+      if (position_error > 1e-4)
+        result.pose_error++;
+    }
+
+    ROS_INFO("%-60s success %6.2f %%, %9.2f us/call, max position error %.2e m (%u above 0.1 mm)",
+             solver_names[index].c_str(),
+             100.0 * result.success / samples,
+             1e6 * result.solve_time / samples,
+             result.max_position_error,
+             result.pose_error);
+  }
+
+  solvers.clear();
+  return 0;
+}
@@ -0,0 +1,524 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_planning_adapters/jerk_limited_time_parameterization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace open_manipulator_planning_adapters;
+
+static const double EPSILON        = 1e-9;
+static const double PATH_STEP      = 0.01;   // rad, longer segments are subdivided
+static const int    BISECTION_STEP = 30;
+
+JerkLimitedTimeParameterization::JerkLimitedTimeParameterization(int max_iterations, double jerk_tolerance)
+  : max_iterations_(max_iterations),
+    jerk_tolerance_(jerk_tolerance),
+    joint_num_(0)
+{
+}
+
+bool JerkLimitedTimeParameterization::initPath(const std::vector<double> &positions)
+{
+  const size_t waypoints = positions.size() / joint_num_;
+
+  node_index_.assign(waypoints, 0);
+  path_.assign(positions.begin(), positions.begin() + joint_num_);
+  s_.assign(1, 0.0);
+
+  for (size_t waypoint = 1; waypoint < waypoints; waypoint++)
+  {
+    const double *previous = &positions[(waypoint - 1) * joint_num_];
+    const double *position = &positions[waypoint * joint_num_];
+
+    double length = 0.0;
+    for (size_t joint = 0; joint < joint_num_; joint++)
+      length += (position[joint] - previous[joint]) * (position[joint] - previous[joint]);
+    length = std::sqrt(length);
+
+    // Repeated waypoints share the node (and the time) of the previous one
+    if (length > EPSILON)
+    {
+      const int steps = std::max(1, (int)std::ceil(length / PATH_STEP));
+
+      for (int step = 1; step <= steps; step++)
+      {
+        const double ratio = (double)step / steps;
+
+        for (size_t joint = 0; joint < joint_num_; joint++)
+          path_.push_back(previous[joint] + (position[joint] - previous[joint]) * ratio);
+
+        s_.push_back(s_.back() + length / steps);
+      }
+    }
+
+    node_index_[waypoint] = s_.size() - 1;
+  }
+
+  const size_t nodes = s_.size();
+  if (nodes < 2)
+    return false;
+
+  // Path derivatives, three point formulas on the non uniform arc length between the distinct waypoints.
+  // The subdivided nodes are interpolated, on the straight pieces alone the curvature would all sit on the waypoints.
+  std::vector<size_t> knots(1, 0);
+  for (size_t waypoint = 1; waypoint < waypoints; waypoint++)
+  {
+    if (node_index_[waypoint] != knots.back())
+      knots.push_back(node_index_[waypoint]);
+  }
+
+  dq_.assign(nodes * joint_num_, 0.0);
+  ddq_.assign(nodes * joint_num_, 0.0);
+
+  for (size_t knot = 0; knot < knots.size(); knot++)
+  {
+    const size_t node = knots[knot];
+
+    for (size_t joint = 0; joint < joint_num_; joint++)
+    {
+      const size_t index = node * joint_num_ + joint;
+
+      if (knot == 0)
+      {
+        const size_t next = knots[1] * joint_num_ + joint;
+        dq_[index] = (path_[next] - path_[index]) / (s_[knots[1]] - s_[node]);
+      }
+      else if (knot == knots.size() - 1)
+      {
+        const size_t previous = knots[knot - 1] * joint_num_ + joint;
+        dq_[index] = (path_[index] - path_[previous]) / (s_[node] - s_[knots[knot - 1]]);
+      }
+      else
+      {
+        const double h0 = s_[node] - s_[knots[knot - 1]];
+        const double h1 = s_[knots[knot + 1]] - s_[node];
+        const double forward  = path_[knots[knot + 1] * joint_num_ + joint] - path_[index];
+        const double backward = path_[index] - path_[knots[knot - 1] * joint_num_ + joint];
+
+        dq_[index]  = (h0 * h0 * forward + h1 * h1 * backward) / (h0 * h1 * (h0 + h1));
+        ddq_[index] = 2.0 * (h0 * forward - h1 * backward) / (h0 * h1 * (h0 + h1));
+      }
+    }
+
+    if (knot == 0)
+      continue;
+
+    const size_t previous = knots[knot - 1];
+    for (size_t between = previous + 1; between < node; between++)
+    {
+      const double ratio = (s_[between] - s_[previous]) / (s_[node] - s_[previous]);
+
+      for (size_t joint = 0; joint < joint_num_; joint++)
+      {
+        const size_t from = previous * joint_num_ + joint;
+        const size_t to   = node * joint_num_ + joint;
+
+        dq_[between * joint_num_ + joint]  = dq_[from] + (dq_[to] - dq_[from]) * ratio;
+        ddq_[between * joint_num_ + joint] = ddq_[from] + (ddq_[to] - ddq_[from]) * ratio;
+      }
+    }
+  }
+
+  path_jerk_.assign(nodes, std::numeric_limits<double>::max());
+  for (size_t node = 0; node < nodes; node++)
+  {
+    for (size_t joint = 0; joint < joint_num_; joint++)
+    {
+      const double dq = std::fabs(dq_[node * joint_num_ + joint]);
+
+      if (dq > EPSILON)
+        path_jerk_[node] = std::min(path_jerk_[node], scaled_limits_[joint].max_jerk / dq);
+    }
+  }
+
+  return true;
+}
+
+bool JerkLimitedTimeParameterization::getAccelerationRange(size_t node, double x, double *lower, double *upper) const
+{
+  *lower = -std::numeric_limits<double>::max();
+  *upper = std::numeric_limits<double>::max();
+
+  // -a <= dq * u + ddq * x <= a for every joint
+  for (size_t joint = 0; joint < joint_num_; joint++)
+  {
+    const double dq    = dq_[node * joint_num_ + joint];
+    const double ddq_x = ddq_[node * joint_num_ + joint] * x;
+    const double a     = scaled_limits_[joint].max_acceleration;
+
+    if (std::fabs(dq) < EPSILON)
+    {
+      if (std::fabs(ddq_x) > a)
+        return false;
+      continue;
+    }
+
+    double low  = (-a - ddq_x) / dq;
+    double high = (a - ddq_x) / dq;
+    if (dq < 0.0)
+      std::swap(low, high);
+
+    *lower = std::max(*lower, low);
+    *upper = std::min(*upper, high);
+  }
+
+  return *lower <= *upper;
+}
+
+double JerkLimitedTimeParameterization::getMaxPathVelocitySquared(size_t node) const
+{
+  double x_max = std::numeric_limits<double>::max();
+
+  for (size_t joint = 0; joint < joint_num_; joint++)
+  {
+    const double dq = std::fabs(dq_[node * joint_num_ + joint]);
+
+    if (dq > EPSILON)
+      x_max = std::min(x_max, std::pow(scaled_limits_[joint].max_velocity / dq, 2.0));
+  }
+
+  double lower, upper;
+  if (getAccelerationRange(node, x_max, &lower, &upper))
+    return x_max;
+
+  // Curvature: the centripetal term ddq * x alone may exceed the acceleration limit
+  double low = 0.0, high = x_max;
+  for (int step = 0; step < BISECTION_STEP; step++)
+  {
+    const double x = 0.5 * (low + high);
+
+    if (getAccelerationRange(node, x, &lower, &upper))
+      low = x;
+    else
+      high = x;
+  }
+
+  return low;
+}
+
+double JerkLimitedTimeParameterization::getStartPathVelocitySquared(void) const
+{
+  if (start_velocity_.size() != joint_num_)
+    return 0.0;
+
+  // dq/ds has unit length on the arc length, the velocity across the path is left out
+  double path_velocity = 0.0;
+  for (size_t joint = 0; joint < joint_num_; joint++)
+    path_velocity += start_velocity_[joint] * dq_[joint];
+
+  return (path_velocity > 0.0) ? path_velocity * path_velocity : 0.0;
+}
+
+bool JerkLimitedTimeParameterization::canMerge(const std::vector<double> &curve, size_t node, double x, double u,
+                                               double dt, int direction) const
+{
+  // Ease the path acceleration down at the jerk limit from here on. The speed has to
+  // stay below the curve until the acceleration is down to the slope of the curve.
+  for (long index = (long)node; ; index += direction)
+  {
+    const long next = index + direction;
+    if (next < 0 || next >= (long)s_.size())
+      return x <= curve[index] + EPSILON;
+
+    const double ds = std::fabs(s_[next] - s_[index]);
+    if (u <= (curve[next] - curve[index]) / (2.0 * ds))
+      return true;
+
+    const double x_next = x + 2.0 * u * ds;
+    if (x_next > curve[next])
+      return false;
+    if (x_next <= 0.0)
+      return true;
+
+    const double dt_next = 2.0 * ds / (std::sqrt(x) + std::sqrt(x_next));
+
+    u -= std::min(path_jerk_[index], path_jerk_[next]) * 0.5 * (dt + dt_next);
+    x  = x_next;
+    dt = dt_next;
+  }
+}
+
+void JerkLimitedTimeParameterization::integrate(int direction, const std::vector<double> &curve, std::vector<double> &x)
+{
+  // Along the pass, u is the path acceleration in the direction of the pass
+  const size_t nodes = s_.size();
+  const long first   = (direction > 0) ? 0 : (long)nodes - 1;
+
+  // Starts on the curve, at rest or at the start velocity
+  x.assign(nodes, 0.0);
+  x[first] = curve[first];
+  double u_previous  = 0.0;
+  double dt_previous = 0.0;
+
+  for (size_t step = 0; step + 1 < nodes; step++)
+  {
+    const long node   = first + direction * (long)step;
+    const long next   = node + direction;
+    const double ds   = std::fabs(s_[next] - s_[node]);
+    const double jerk = std::min(path_jerk_[node], path_jerk_[next]);
+
+    double lower, upper;
+    if (!getAccelerationRange(node, x[node], &lower, &upper))
+      lower = upper = 0.0;
+    const double u_max = (direction > 0) ? upper : -lower;
+
+    // Largest speed at the next node that keeps the acceleration, the jerk and the curve ahead
+    double low = 0.0, high = curve[next];
+
+    for (int bisection = 0; bisection < BISECTION_STEP; bisection++)
+    {
+      const double x_next = (bisection == 0) ? high : 0.5 * (low + high);
+      const double u      = (x_next - x[node]) / (2.0 * ds);
+
+      const double root = std::sqrt(x[node]) + std::sqrt(x_next);
+      const double dt   = (root > EPSILON) ? 2.0 * ds / root : std::cbrt(6.0 * ds / jerk);
+
+      // Segment accelerations are constant, the jerk is their change over the time between segment centers
+      const bool is_feasible = (u <= u_max && u <= u_previous + jerk * 0.5 * (dt_previous + dt)
+                                && canMerge(curve, next, x_next, u, dt, direction));
+
+      if (is_feasible)
+      {
+        low = x_next;
+        if (bisection == 0)
+          break;
+      }
+      else
+      {
+        high = x_next;
+      }
+    }
+
+    const double root = std::sqrt(x[node]) + std::sqrt(low);
+
+    x[next]     = low;
+    u_previous  = (low - x[node]) / (2.0 * ds);
+    dt_previous = (root > EPSILON) ? 2.0 * ds / root : 0.0;
+  }
+}
+
+double JerkLimitedTimeParameterization::updatePathJerk(void)
+{
+  // Joint jerk between nodes, with the path acceleration of a node taken as the mean of its segments
+  const size_t nodes = s_.size();
+  double max_ratio = 0.0;
+  std::vector<double> ratio(nodes, 0.0);
+
+  double previous_acceleration[32];
+  for (size_t node = 0; node < nodes; node++)
+  {
+    const double u = (node == 0) ? u_[0] : (node == nodes - 1) ? u_[node - 1] : 0.5 * (u_[node - 1] + u_[node]);
+    const double dt = (node == 0) ? 0.0 : getSegmentTime(node);
+    const bool is_at_rest = (node > 0 && std::sqrt(x_[node - 1]) + std::sqrt(x_[node]) <= EPSILON);
+
+    for (size_t joint = 0; joint < joint_num_ && joint < 32; joint++)
+    {
+      const size_t index = node * joint_num_ + joint;
+      const double acceleration = dq_[index] * u + ddq_[index] * x_[node];
+
+      if (node > 0 && dt > EPSILON)
+      {
+        double node_ratio = std::fabs(acceleration - previous_acceleration[joint]) / dt / scaled_limits_[joint].max_jerk;
+
+        // A segment from rest to rest needs at least 32 ds / dt^3 of path jerk, its accelerations are not on the nodes
+        if (is_at_rest)
+        {
+          const double dq = std::max(std::fabs(dq_[index]), std::fabs(dq_[index - joint_num_]));
+          node_ratio = std::max(node_ratio, 32.0 * (s_[node] - s_[node - 1]) / (dt * dt * dt) * dq / scaled_limits_[joint].max_jerk);
+        }
+
+        ratio[node]     = std::max(ratio[node], node_ratio);
+        ratio[node - 1] = std::max(ratio[node - 1], node_ratio);
+        max_ratio       = std::max(max_ratio, node_ratio);
+      }
+
+      previous_acceleration[joint] = acceleration;
+    }
+  }
+
+  // The curvature adds to the joint jerk of the path acceleration ramps, slow them down where the limit is exceeded
+  if (max_ratio > 1.0 + jerk_tolerance_)
+  {
+    for (size_t node = 0; node < nodes; node++)
+    {
+      if (ratio[node] > 1.0 + jerk_tolerance_)
+        path_jerk_[node] /= std::min(ratio[node], 2.0);
+    }
+  }
+
+  return max_ratio;
+}
+
+double JerkLimitedTimeParameterization::getSegmentTime(size_t node) const
+{
+  // Segment from node - 1 to node
+  const double ds   = s_[node] - s_[node - 1];
+  const double root = std::sqrt(x_[node - 1]) + std::sqrt(x_[node]);
+
+  if (root > EPSILON)
+    return 2.0 * ds / root;
+
+  // From rest to rest the path jerk goes up, down and up again: ds = jerk t^3 / 32, unless the
+  // acceleration peak jerk t / 4 exceeds its limit and is held in between
+  const double jerk = std::min(path_jerk_[node - 1], path_jerk_[node]);
+  const double jerk_time = std::cbrt(32.0 * ds / jerk);
+
+  double acceleration = std::numeric_limits<double>::max();
+  double lower, upper;
+  if (getAccelerationRange(node - 1, 0.0, &lower, &upper))
+    acceleration = std::min(acceleration, upper);
+  if (getAccelerationRange(node, 0.0, &lower, &upper))
+    acceleration = std::min(acceleration, upper);
+
+  if (jerk * jerk_time * 0.25 <= acceleration)
+    return jerk_time;
+
+  const double ramp_time = acceleration / jerk;
+  return ramp_time + std::sqrt(ramp_time * ramp_time + 4.0 * ds / acceleration);
+}
+
+double JerkLimitedTimeParameterization::getDuration(std::vector<double> *node_time) const
+{
+  double time = 0.0;
+
+  for (size_t node = 1; node < s_.size(); node++)
+  {
+    time += getSegmentTime(node);
+    if (node_time != NULL)
+      (*node_time)[node] = time;
+  }
+
+  return time;
+}
+
+bool JerkLimitedTimeParameterization::compute(const std::vector<double> &positions, double velocity_scale, double acceleration_scale,
+                                              std::vector<double> &time_from_start, std::vector<double> &velocities,
+                                              std::vector<double> &accelerations, TimeParameterizationResult *result)
+{
+  joint_num_ = limits_.size();
+  if (joint_num_ == 0 || joint_num_ > 32 || positions.size() < joint_num_ || positions.size() % joint_num_ != 0)
+    return false;
+
+  velocity_scale     = (velocity_scale > 0.0 && velocity_scale <= 1.0) ? velocity_scale : 1.0;
+  acceleration_scale = (acceleration_scale > 0.0 && acceleration_scale <= 1.0) ? acceleration_scale : 1.0;
+
+  scaled_limits_ = limits_;
+  for (size_t joint = 0; joint < joint_num_; joint++)
+  {
+    scaled_limits_[joint].max_velocity     *= velocity_scale;
+    scaled_limits_[joint].max_acceleration *= acceleration_scale;
+    scaled_limits_[joint].max_jerk         *= acceleration_scale;
+  }
+
+  const size_t waypoints = positions.size() / joint_num_;
+  time_from_start.assign(waypoints, 0.0);
+  velocities.assign(positions.size(), 0.0);
+  accelerations.assign(positions.size(), 0.0);
+
+  if (!initPath(positions))
+  {
+    if (result != NULL)
+    {
+      result->duration       = 0.0;
+      result->max_jerk_ratio = 0.0;
+      result->iterations     = 0;
+    }
+    return true;
+  }
+
+  const size_t nodes = s_.size();
+
+  u_.assign(nodes, 0.0);
+  x_limit_.resize(nodes);
+  for (size_t node = 0; node < nodes; node++)
+    x_limit_[node] = getMaxPathVelocitySquared(node);
+  x_limit_.front() = std::min(x_limit_.front(), getStartPathVelocitySquared());
+  x_limit_.back()  = 0.0;
+
+  // Each iterate is feasible once stretched in time by the cube root of its jerk ratio (jerk scales with 1 / k^3,
+  // acceleration and velocity with 1 / k^2 and 1 / k), the fastest stretched iterate is kept
+  std::vector<double> best_x;
+  double best_duration = std::numeric_limits<double>::max();
+  double max_jerk_ratio = 0.0;
+  int iteration = 0;
+
+  for (iteration = 1; iteration <= max_iterations_; iteration++)
+  {
+    integrate(-1, x_limit_, x_backward_);
+    integrate(1, x_backward_, x_);
+
+    for (size_t node = 0; node + 1 < nodes; node++)
+      u_[node] = (x_[node + 1] - x_[node]) / (2.0 * (s_[node + 1] - s_[node]));
+
+    const double jerk_ratio = updatePathJerk();
+    const double duration   = getDuration() * std::cbrt(std::max(1.0, jerk_ratio));
+
+    if (duration < best_duration)
+    {
+      best_x.swap(x_);
+      best_duration  = duration;
+      max_jerk_ratio = jerk_ratio;
+    }
+
+    if (jerk_ratio <= 1.0 + jerk_tolerance_)
+      break;
+  }
+
+  x_.swap(best_x);
+  for (size_t node = 0; node + 1 < nodes; node++)
+    u_[node] = (x_[node + 1] - x_[node]) / (2.0 * (s_[node + 1] - s_[node]));
+
+  const double stretch = std::cbrt(std::max(1.0, max_jerk_ratio));
+
+  std::vector<double> node_time(nodes, 0.0);
+  getDuration(&node_time);
+
+  for (size_t waypoint = 0; waypoint < waypoints; waypoint++)
+  {
+    const size_t node = node_index_[waypoint];
+    const double u = (node == 0) ? u_[0] : (node == nodes - 1) ? u_[node - 1] : 0.5 * (u_[node - 1] + u_[node]);
+    const double path_velocity = std::sqrt(x_[node]);
+
+    time_from_start[waypoint] = node_time[node] * stretch;
+
+    for (size_t joint = 0; joint < joint_num_; joint++)
+    {
+      const size_t index = node * joint_num_ + joint;
+
+      velocities[waypoint * joint_num_ + joint]    = dq_[index] * path_velocity / stretch;
+      accelerations[waypoint * joint_num_ + joint] = (dq_[index] * u + ddq_[index] * x_[node]) / (stretch * stretch);
+    }
+  }
+
+  // The path starts without acceleration and rests at its end
+  for (size_t joint = 0; joint < joint_num_; joint++)
+  {
+    accelerations[joint] = 0.0;
+    accelerations[(waypoints - 1) * joint_num_ + joint] = 0.0;
+  }
+
+  if (result != NULL)
+  {
+    result->duration       = node_time.back() * stretch;
+    result->max_jerk_ratio = max_jerk_ratio / (stretch * stretch * stretch);
+    result->iterations     = std::min(iteration, max_iterations_);
+  }
+
+  return true;
+}
@@ -0,0 +1,171 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_planning_adapters/jerk_limited_trajectory_timing.h"
+
+#include <algorithm>
+
+using namespace open_manipulator_planning_adapters;
+
+JerkLimitedTrajectoryTiming::JerkLimitedTrajectoryTiming()
+  : nh_("~")
+{
+  nh_.param<int>("jerk_limited_timing/max_iterations",      max_iterations_,   10);
+  nh_.param<double>("jerk_limited_timing/jerk_tolerance",   jerk_tolerance_,   0.05);
+  nh_.param<double>("jerk_limited_timing/default_max_jerk", default_max_jerk_, 5.0);
+}
+
+bool JerkLimitedTrajectoryTiming::getJointLimits(const robot_model::JointModelGroup *joint_model_group,
+                                                 std::vector<JointLimit> &limits) const
+{
+  const std::vector<std::string> &variable_names = joint_model_group->getVariableNames();
+  const robot_model::RobotModel *robot_model = joint_model_group->getParentModel();
+
+  // Same keys as position_ctrl, relative to the node namespace like robot_description
+  ros::NodeHandle nh;
+
+  boost::mutex::scoped_lock lock(limits_mutex_);
+  limits.resize(variable_names.size());
+
+  for (std::size_t index = 0; index < variable_names.size(); index++)
+  {
+    std::map<std::string, JointLimit>::const_iterator cached = limits_.find(variable_names[index]);
+    if (cached != limits_.end())
+    {
+      limits[index] = cached->second;
+      continue;
+    }
+
+    // The URDF bounds when joint_limits.yaml has none
+    const moveit::core::VariableBounds &bounds = robot_model->getVariableBounds(variable_names[index]);
+    const std::string prefix = "robot_description_planning/joint_limits/" + variable_names[index] + "/";
+    JointLimit limit;
+
+    nh.param<double>(prefix + "max_velocity",     limit.max_velocity,     bounds.velocity_bounded_ ? bounds.max_velocity_ : 1.0);
+    nh.param<double>(prefix + "max_acceleration", limit.max_acceleration, bounds.acceleration_bounded_ ? bounds.max_acceleration_ : 1.0);
+    nh.param<double>(prefix + "max_jerk",         limit.max_jerk,         default_max_jerk_);
+
+    if (limit.max_velocity <= 0.0 || limit.max_acceleration <= 0.0 || limit.max_jerk <= 0.0)
+    {
+      ROS_ERROR("Joint limits of %s are not positive", variable_names[index].c_str());
+      return false;
+    }
+
+    limits_[variable_names[index]] = limit;
+    limits[index] = limit;
+  }
+
+  return true;
+}
+
+bool JerkLimitedTrajectoryTiming::computeTimeStamps(robot_trajectory::RobotTrajectory &trajectory,
+                                                    double max_velocity_scaling_factor, double max_acceleration_scaling_factor,
+                                                    TimeParameterizationResult *result) const
+{
+  return computeTimeStamps(trajectory, std::vector<double>(), max_velocity_scaling_factor, max_acceleration_scaling_factor,
+                           result);
+}
+
+bool JerkLimitedTrajectoryTiming::computeTimeStamps(robot_trajectory::RobotTrajectory &trajectory,
+                                                    const moveit_msgs::RobotState &start_state,
+                                                    double max_velocity_scaling_factor, double max_acceleration_scaling_factor,
+                                                    TimeParameterizationResult *result) const
+{
+  const robot_model::JointModelGroup *joint_model_group = trajectory.getGroup();
+  const sensor_msgs::JointState &joint_state = start_state.joint_state;
+  std::vector<double> start_velocity;
+
+  // Only the velocities given in the request count, a start state without them is at rest
+  if (joint_model_group != NULL && !joint_state.velocity.empty())
+  {
+    const std::vector<std::string> &variable_names = joint_model_group->getVariableNames();
+    start_velocity.assign(variable_names.size(), 0.0);
+
+    for (std::size_t index = 0; index < joint_state.name.size() && index < joint_state.velocity.size(); index++)
+    {
+      std::vector<std::string>::const_iterator it = std::find(variable_names.begin(), variable_names.end(), joint_state.name[index]);
+      if (it != variable_names.end())
+        start_velocity[it - variable_names.begin()] = joint_state.velocity[index];
+    }
+  }
+
+  return computeTimeStamps(trajectory, start_velocity, max_velocity_scaling_factor, max_acceleration_scaling_factor,
+                           result);
+}
+
+bool JerkLimitedTrajectoryTiming::computeTimeStamps(robot_trajectory::RobotTrajectory &trajectory,
+                                                    const std::vector<double> &start_velocity,
+                                                    double max_velocity_scaling_factor, double max_acceleration_scaling_factor,
+                                                    TimeParameterizationResult *result) const
+{
+  const robot_model::JointModelGroup *joint_model_group = trajectory.getGroup();
+  if (joint_model_group == NULL)
+  {
+    ROS_ERROR("It looks like the planner did not set the group the plan was computed for");
+    return false;
+  }
+
+  const std::size_t num_points = trajectory.getWayPointCount();
+  if (num_points == 0)
+    return true;
+
+  std::vector<JointLimit> limits;
+  if (!getJointLimits(joint_model_group, limits))
+    return false;
+
+  const std::vector<int> &variable_index = joint_model_group->getVariableIndexList();
+  const std::size_t joint_num = variable_index.size();
+
+  std::vector<double> positions(num_points * joint_num);
+  for (std::size_t point = 0; point < num_points; point++)
+  {
+    const double *state_positions = trajectory.getWayPoint(point).getVariablePositions();
+    for (std::size_t joint = 0; joint < joint_num; joint++)
+      positions[point * joint_num + joint] = state_positions[variable_index[joint]];
+  }
+
+  // The core keeps its working buffers, one per call keeps the adapters reentrant
+  JerkLimitedTimeParameterization time_parameterization(max_iterations_, jerk_tolerance_);
+  time_parameterization.setLimits(limits);
+  time_parameterization.setStartVelocity(start_velocity);
+
+  std::vector<double> time_from_start, velocities, accelerations;
+  if (!time_parameterization.compute(positions, max_velocity_scaling_factor, max_acceleration_scaling_factor,
+                                     time_from_start, velocities, accelerations, result))
+    return false;
+
+  // Repeated waypoints get the time of the previous one, they are left out instead of being given no duration
+  robot_trajectory::RobotTrajectory timed(trajectory.getRobotModel(), trajectory.getGroupName());
+
+  for (std::size_t point = 0; point < num_points; point++)
+  {
+    if (point > 0 && time_from_start[point] <= time_from_start[point - 1])
+      continue;
+
+    robot_state::RobotStatePtr state = trajectory.getWayPointPtr(point);
+
+    for (std::size_t joint = 0; joint < joint_num; joint++)
+    {
+      state->setVariableVelocity(variable_index[joint], velocities[point * joint_num + joint]);
+      state->setVariableAcceleration(variable_index[joint], accelerations[point * joint_num + joint]);
+    }
+
+    timed.addSuffixWayPoint(state, (point == 0) ? 0.0 : time_from_start[point] - time_from_start[point - 1]);
+  }
+
+  trajectory.swap(timed);
+  return true;
+}
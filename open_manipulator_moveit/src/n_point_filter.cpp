@@ -122,9 +122,75 @@ template<typename T>
     return success;
   }
 
+NPointTrajectoryFilter::NPointTrajectoryFilter() :
+    TrajectoryFilterBase(), n_points_(DEFAULT_N)
+{
+  filter_name_ = "NPointFilter";
+  filter_type_ = "NPointTrajectoryFilter";
+}
+
+bool NPointTrajectoryFilter::configure()
+{
+  if (!nh_.getParam("n_points", n_points_))
+  {
+    ROS_WARN_STREAM("NPointFilter, params has no attribute n_points.");
+  }
+  if (n_points_ < 2)
+  {
+    ROS_WARN_STREAM( "n_points attribute less than min(2), setting to minimum");
+    n_points_ = 2;
+  }
+  ROS_INFO_STREAM("Using a n_points value of " << n_points_);
+
+  return true;
+}
+
+bool NPointTrajectoryFilter::update(robot_trajectory::RobotTrajectory& trajectory)
+{
+  int size_in = trajectory.getWayPointCount();
+
+  if (size_in <= n_points_)
+  {
+    ROS_DEBUG_STREAM("Trajectory size less than n: " << n_points_ << ", pass through");
+    return true;
+  }
+
+  // Same indices as NPointFilter<T>::update
+  int intermediate_points = n_points_ - 2; //subtract the first and last elements
+  double int_point_increment = double(size_in) / double(intermediate_points + 1.0);
+
+  std::vector<double> time_from_start(size_in);
+  double time = 0.0;
+  for (int index = 0; index < size_in; index++)
+  {
+    time += trajectory.getWayPointDurationFromPrevious(index);
+    time_from_start[index] = time;
+  }
+
+  robot_trajectory::RobotTrajectory trajectory_out(trajectory.getRobotModel(), trajectory.getGroupName());
+  int previous_index = 0;
+
+  trajectory_out.addSuffixWayPoint(trajectory.getWayPoint(0), time_from_start[0]);
+  for (int i = 1; i <= intermediate_points + 1; i++)
+  {
+    int int_point_index = (i <= intermediate_points) ? int(double(i) * int_point_increment) : size_in - 1;
+
+    trajectory_out.addSuffixWayPoint(trajectory.getWayPoint(int_point_index),
+                                     time_from_start[int_point_index] - time_from_start[previous_index]);
+    previous_index = int_point_index;
+  }
+
+  ROS_DEBUG_STREAM("Filtered trajectory from: " << size_in << " to: " << trajectory_out.getWayPointCount());
+
+  trajectory.swap(trajectory_out);
+  return true;
+}
+
 // registering planner adapter
 CLASS_LOADER_REGISTER_CLASS(industrial_trajectory_filters::NPointFilterAdapter,
                             planning_request_adapter::PlanningRequestAdapter);
+CLASS_LOADER_REGISTER_CLASS(industrial_trajectory_filters::NPointTrajectoryFilter,
+                            planning_request_adapter::PlanningRequestAdapter);
 
 /*
  * Old plugin declaration for arm navigation trajectory filters
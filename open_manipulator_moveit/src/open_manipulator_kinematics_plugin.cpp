@@ -0,0 +1,505 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_kinematics/open_manipulator_kinematics_plugin.h"
+
+#include <moveit/rdf_loader/rdf_loader.h>
+#include <class_loader/class_loader.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace open_manipulator_kinematics;
+
+const double DEFAULT_PITCH_DISCRETIZATION  = 0.005;  // rad
+const double DEFAULT_ORIENTATION_TOLERANCE = 0.001;  // rad
+const double GEOMETRY_TOLERANCE            = 1e-6;
+
+// Parameters are read from the kinematics namespace loaded by planning_context.launch
+// and may be overridden in the private namespace of the node loading the plugin
+template<typename T>
+static void getKinematicsParam(const std::string &robot_description, const std::string &group_name,
+                               const std::string &name, T &value, const T &default_value)
+{
+  ros::NodeHandle node_handle;
+  ros::NodeHandle priv_node_handle("~");
+
+  value = default_value;
+
+  if (priv_node_handle.getParam(group_name + "/" + name, value))
+    return;
+
+  node_handle.getParam(robot_description + "_kinematics/" + group_name + "/" + name, value);
+}
+
+static void poseMsgToEigen(const geometry_msgs::Pose &pose, Eigen::Vector3d &position, Eigen::Matrix3d &orientation)
+{
+  position = Eigen::Vector3d(pose.position.x, pose.position.y, pose.position.z);
+  orientation = Eigen::Quaterniond(pose.orientation.w, pose.orientation.x, pose.orientation.y, pose.orientation.z)
+                  .normalized().toRotationMatrix();
+}
+
+static void poseEigenToMsg(const Eigen::Vector3d &position, const Eigen::Matrix3d &orientation, geometry_msgs::Pose &pose)
+{
+  const Eigen::Quaterniond quaternion(orientation);
+
+  pose.position.x    = position.x();
+  pose.position.y    = position.y();
+  pose.position.z    = position.z();
+  pose.orientation.x = quaternion.x();
+  pose.orientation.y = quaternion.y();
+  pose.orientation.z = quaternion.z();
+  pose.orientation.w = quaternion.w();
+}
+
+OpenManipulatorKinematicsPlugin::OpenManipulatorKinematicsPlugin()
+    :active_(false),
+     position_only_ik_(false),
+     pitch_discretization_(DEFAULT_PITCH_DISCRETIZATION),
+     joint_model_group_(NULL)
+{
+}
+
+OpenManipulatorKinematicsPlugin::~OpenManipulatorKinematicsPlugin()
+{
+}
+
+bool OpenManipulatorKinematicsPlugin::initialize(const std::string &robot_description,
+                                                 const std::string &group_name,
+                                                 const std::string &base_frame,
+                                                 const std::string &tip_frame,
+                                                 double search_discretization)
+{
+  setValues(robot_description, group_name, base_frame, tip_frame, search_discretization);
+
+  rdf_loader::RDFLoader rdf_loader(robot_description);
+
+  if (!rdf_loader.getURDF() || !rdf_loader.getSRDF())
+  {
+    ROS_ERROR_NAMED("open_manipulator_kinematics", "URDF and SRDF must be loaded for the kinematics solver");
+    return false;
+  }
+
+  robot_model_.reset(new robot_model::RobotModel(rdf_loader.getURDF(), rdf_loader.getSRDF()));
+
+  joint_model_group_ = robot_model_->getJointModelGroup(group_name);
+  if (joint_model_group_ == NULL)
+    return false;
+
+  if (initGeometry(base_frame, tip_frame) == false)
+    return false;
+
+  double orientation_tolerance = DEFAULT_ORIENTATION_TOLERANCE;
+
+  getKinematicsParam(robot_description, group_name, "position_only_ik", position_only_ik_, false);
+  getKinematicsParam(robot_description, group_name, "orientation_tolerance", orientation_tolerance, DEFAULT_ORIENTATION_TOLERANCE);
+
+  solver_.setOrientationTolerance(orientation_tolerance);
+
+  pitch_discretization_ = (search_discretization > 0.0) ? search_discretization : DEFAULT_PITCH_DISCRETIZATION;
+
+  ROS_INFO_NAMED("open_manipulator_kinematics", "Analytic IK for '%s' (%s -> %s), position only: %s",
+                 group_name.c_str(), base_frame.c_str(), tip_frame.c_str(), position_only_ik_ ? "true" : "false");
+
+  active_ = true;
+  return true;
+}
+
+bool OpenManipulatorKinematicsPlugin::initGeometry(const std::string &base_frame, const std::string &tip_frame)
+{
+  const std::vector<const robot_model::JointModel*> &joint_models = joint_model_group_->getActiveJointModels();
+
+  if (joint_models.size() != CHAIN_JOINT_NUM || robot_model_->hasLinkModel(base_frame) == false ||
+      robot_model_->hasLinkModel(tip_frame) == false)
+  {
+    ROS_ERROR_NAMED("open_manipulator_kinematics", "Group '%s' is not a %d joint chain from '%s' to '%s'",
+                    joint_model_group_->getName().c_str(), CHAIN_JOINT_NUM, base_frame.c_str(), tip_frame.c_str());
+    return false;
+  }
+
+  // Read the chain geometry from the robot model with every joint at zero
+  robot_state::RobotState state(robot_model_);
+  state.setToDefaultValues();
+
+  std::vector<double> zero_position(joint_model_group_->getVariableCount(), 0.0);
+  state.setJointGroupPositions(joint_model_group_, zero_position);
+  state.update();
+
+  const Eigen::Affine3d base_inverse = state.getGlobalLinkTransform(base_frame).inverse();
+
+  Eigen::Vector3d joint_origin[CHAIN_JOINT_NUM];
+  double lower_limit[CHAIN_JOINT_NUM], upper_limit[CHAIN_JOINT_NUM];
+
+  joint_names_.clear();
+
+  for (uint8_t index = 0; index < CHAIN_JOINT_NUM; index++)
+  {
+    const robot_model::JointModel *joint_model = joint_models[index];
+
+    if (joint_model->getType() != robot_model::JointModel::REVOLUTE)
+    {
+      ROS_ERROR_NAMED("open_manipulator_kinematics", "Joint '%s' is not revolute", joint_model->getName().c_str());
+      return false;
+    }
+
+    const Eigen::Affine3d joint_frame = base_inverse * state.getGlobalLinkTransform(joint_model->getChildLinkModel());
+    const Eigen::Vector3d joint_axis  = joint_frame.rotation() *
+                                        static_cast<const robot_model::RevoluteJointModel*>(joint_model)->getAxis();
+    const Eigen::Vector3d expected_axis = (index == 0) ? Eigen::Vector3d::UnitZ() : Eigen::Vector3d::UnitY();
+
+    if (joint_frame.rotation().isIdentity(GEOMETRY_TOLERANCE) == false ||
+        joint_axis.isApprox(expected_axis, GEOMETRY_TOLERANCE) == false)
+    {
+      ROS_ERROR_NAMED("open_manipulator_kinematics", "Joint '%s' does not match the yaw + pitch chain layout",
+                      joint_model->getName().c_str());
+      return false;
+    }
+
+    joint_origin[index] = joint_frame.translation();
+
+    const robot_model::VariableBounds &bounds = joint_model->getVariableBounds()[0];
+    lower_limit[index] = bounds.position_bounded_ ? bounds.min_position_ : -M_PI;
+    upper_limit[index] = bounds.position_bounded_ ? bounds.max_position_ :  M_PI;
+
+    joint_names_.push_back(joint_model->getName());
+  }
+
+  const Eigen::Affine3d tip = base_inverse * state.getGlobalLinkTransform(tip_frame);
+
+  if (tip.rotation().isIdentity(GEOMETRY_TOLERANCE) == false)
+  {
+    ROS_ERROR_NAMED("open_manipulator_kinematics", "Tip frame '%s' must be aligned with the last joint", tip_frame.c_str());
+    return false;
+  }
+
+  // Everything after joint1 must lie in the plane through the joint1 axis
+  const Eigen::Vector3d offsets[] = {joint_origin[1] - joint_origin[0],
+                                     joint_origin[2] - joint_origin[1],
+                                     joint_origin[3] - joint_origin[2],
+                                     tip.translation() - joint_origin[3]};
+
+  for (uint8_t index = 0; index < sizeof(offsets) / sizeof(offsets[0]); index++)
+  {
+    if (std::fabs(offsets[index].y()) > GEOMETRY_TOLERANCE)
+    {
+      ROS_ERROR_NAMED("open_manipulator_kinematics", "Chain has a lateral offset, analytic IK is not applicable");
+      return false;
+    }
+  }
+
+  ChainGeometry geometry;
+  geometry.yaw_axis_x  = joint_origin[0].x();
+  geometry.yaw_axis_y  = joint_origin[0].y();
+  geometry.shoulder_x  = offsets[0].x();
+  geometry.shoulder_z  = joint_origin[1].z();
+  geometry.upper_arm_x = offsets[1].x();
+  geometry.upper_arm_z = offsets[1].z();
+  geometry.forearm_x   = offsets[2].x();
+  geometry.forearm_z   = offsets[2].z();
+  geometry.tip_x       = offsets[3].x();
+  geometry.tip_z       = offsets[3].z();
+
+  solver_.setGeometry(geometry);
+  solver_.setJointLimits(lower_limit, upper_limit);
+
+  link_names_.clear();
+  link_names_.push_back(tip_frame);
+
+  return true;
+}
+
+int OpenManipulatorKinematicsPlugin::collectSolutions(const geometry_msgs::Pose &ik_pose,
+                                                      const std::vector<double> &ik_seed_state,
+                                                      double pitch,
+                                                      ChainSolution *solutions) const
+{
+  Eigen::Vector3d position;
+  Eigen::Matrix3d orientation;
+  poseMsgToEigen(ik_pose, position, orientation);
+
+  int count = 0;
+  if (position_only_ik_)
+    count = solver_.solve(position, pitch, ik_seed_state[0], solutions);
+  else
+    count = solver_.solve(position, orientation, ik_seed_state[0], solutions);
+
+  // Nearest to the seed first (at most CHAIN_MAX_SOLUTIONS entries)
+  double distance[CHAIN_MAX_SOLUTIONS];
+  for (int index = 0; index < count; index++)
+  {
+    distance[index] = 0.0;
+    for (int num = 0; num < CHAIN_JOINT_NUM; num++)
+      distance[index] += std::fabs(solutions[index].position[num] - ik_seed_state[num]);
+  }
+
+  for (int index = 1; index < count; index++)
+  {
+    for (int num = index; num > 0 && distance[num] < distance[num - 1]; num--)
+    {
+      std::swap(distance[num], distance[num - 1]);
+      std::swap(solutions[num], solutions[num - 1]);
+    }
+  }
+
+  return count;
+}
+
+bool OpenManipulatorKinematicsPlugin::checkConsistency(const std::vector<double> &seed_state,
+                                                       const std::vector<double> &consistency_limits,
+                                                       const double *solution) const
+{
+  for (std::size_t index = 0; index < consistency_limits.size(); index++)
+  {
+    if (std::fabs(seed_state[index] - solution[index]) > consistency_limits[index])
+      return false;
+  }
+  return true;
+}
+
+bool OpenManipulatorKinematicsPlugin::searchSolution(const geometry_msgs::Pose &ik_pose,
+                                                     const std::vector<double> &ik_seed_state,
+                                                     double timeout,
+                                                     const std::vector<double> &consistency_limits,
+                                                     std::vector<double> &solution,
+                                                     const IKCallbackFn &solution_callback,
+                                                     moveit_msgs::MoveItErrorCodes &error_code) const
+{
+  if (active_ == false)
+  {
+    ROS_ERROR_NAMED("open_manipulator_kinematics", "Kinematics solver is not active");
+    error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  if (ik_seed_state.size() != CHAIN_JOINT_NUM ||
+      (consistency_limits.empty() == false && consistency_limits.size() != CHAIN_JOINT_NUM))
+  {
+    ROS_ERROR_NAMED("open_manipulator_kinematics", "Seed state and consistency limits must have %d values", CHAIN_JOINT_NUM);
+    error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  const ros::WallTime start_time = ros::WallTime::now();
+  const double seed_pitch = ik_seed_state[1] + ik_seed_state[2] + ik_seed_state[3];
+
+  // Without position_only_ik the pitch is fixed by the target, so only the first step is evaluated
+  const int pitch_steps = position_only_ik_ ? std::ceil(M_PI / pitch_discretization_) : 0;
+
+  ChainSolution solutions[CHAIN_MAX_SOLUTIONS];
+
+  for (int step = 0; step <= pitch_steps; step++)
+  {
+    if (step > 0 && (ros::WallTime::now() - start_time).toSec() > timeout)
+      break;
+
+    for (int direction = 1; direction >= -1; direction -= 2)
+    {
+      if (step == 0 && direction < 0)
+        continue;
+
+      const double pitch = seed_pitch + direction * step * pitch_discretization_;
+      const int count = collectSolutions(ik_pose, ik_seed_state, pitch, solutions);
+
+      for (int index = 0; index < count; index++)
+      {
+        if (checkConsistency(ik_seed_state, consistency_limits, solutions[index].position) == false)
+          continue;
+
+        solution.assign(solutions[index].position, solutions[index].position + CHAIN_JOINT_NUM);
+
+        if (solution_callback.empty())
+        {
+          error_code.val = error_code.SUCCESS;
+          return true;
+        }
+
+        solution_callback(ik_pose, solution, error_code);
+        if (error_code.val == error_code.SUCCESS)
+          return true;
+      }
+    }
+  }
+
+  error_code.val = error_code.NO_IK_SOLUTION;
+  return false;
+}
+
+bool OpenManipulatorKinematicsPlugin::getPositionIK(const geometry_msgs::Pose &ik_pose,
+                                                    const std::vector<double> &ik_seed_state,
+                                                    std::vector<double> &solution,
+                                                    moveit_msgs::MoveItErrorCodes &error_code,
+                                                    const kinematics::KinematicsQueryOptions &options) const
+{
+  // Position only, the seed pitch may be out of reach where another one is not: sweep like searchPositionIK
+  return searchSolution(ik_pose, ik_seed_state, getDefaultTimeout(), std::vector<double>(), solution, IKCallbackFn(), error_code);
+}
+
+bool OpenManipulatorKinematicsPlugin::getPositionIK(const std::vector<geometry_msgs::Pose> &ik_poses,
+                                                    const std::vector<double> &ik_seed_state,
+                                                    std::vector<std::vector<double> > &solutions,
+                                                    kinematics::KinematicsResult &result,
+                                                    const kinematics::KinematicsQueryOptions &options) const
+{
+  solutions.clear();
+  result.solution_percentage = 0.0;
+
+  if (ik_poses.size() != 1)
+  {
+    result.kinematic_error = kinematics::KinematicErrors::MULTIPLE_TIPS_NOT_SUPPORTED;
+    return false;
+  }
+
+  if (active_ == false || ik_seed_state.size() != CHAIN_JOINT_NUM)
+  {
+    result.kinematic_error = kinematics::KinematicErrors::SOLVER_NOT_ACTIVE;
+    return false;
+  }
+
+  // Every yaw and elbow branch, when position only at the pitch closest to the seed that has any
+  ChainSolution chain_solutions[CHAIN_MAX_SOLUTIONS];
+  const ros::WallTime start_time = ros::WallTime::now();
+  const double seed_pitch = ik_seed_state[1] + ik_seed_state[2] + ik_seed_state[3];
+  const int pitch_steps = position_only_ik_ ? std::ceil(M_PI / pitch_discretization_) : 0;
+  int count = 0;
+
+  for (int step = 0; step <= pitch_steps && count == 0; step++)
+  {
+    if (step > 0 && (ros::WallTime::now() - start_time).toSec() > getDefaultTimeout())
+      break;
+
+    for (int direction = 1; direction >= -1 && count == 0; direction -= 2)
+    {
+      if (step == 0 && direction < 0)
+        continue;
+
+      count = collectSolutions(ik_poses[0], ik_seed_state, seed_pitch + direction * step * pitch_discretization_, chain_solutions);
+    }
+  }
+
+  for (int index = 0; index < count; index++)
+    solutions.push_back(std::vector<double>(chain_solutions[index].position, chain_solutions[index].position + CHAIN_JOINT_NUM));
+
+  if (solutions.empty())
+  {
+    result.kinematic_error = kinematics::KinematicErrors::NO_SOLUTION;
+    return false;
+  }
+
+  result.kinematic_error = kinematics::KinematicErrors::OK;
+  result.solution_percentage = 1.0;
+  return true;
+}
+
+bool OpenManipulatorKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                                                       const std::vector<double> &ik_seed_state,
+                                                       double timeout,
+                                                       std::vector<double> &solution,
+                                                       moveit_msgs::MoveItErrorCodes &error_code,
+                                                       const kinematics::KinematicsQueryOptions &options) const
+{
+  return searchSolution(ik_pose, ik_seed_state, timeout, std::vector<double>(), solution, IKCallbackFn(), error_code);
+}
+
+bool OpenManipulatorKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                                                       const std::vector<double> &ik_seed_state,
+                                                       double timeout,
+                                                       const std::vector<double> &consistency_limits,
+                                                       std::vector<double> &solution,
+                                                       moveit_msgs::MoveItErrorCodes &error_code,
+                                                       const kinematics::KinematicsQueryOptions &options) const
+{
+  return searchSolution(ik_pose, ik_seed_state, timeout, consistency_limits, solution, IKCallbackFn(), error_code);
+}
+
+bool OpenManipulatorKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                                                       const std::vector<double> &ik_seed_state,
+                                                       double timeout,
+                                                       std::vector<double> &solution,
+                                                       const IKCallbackFn &solution_callback,
+                                                       moveit_msgs::MoveItErrorCodes &error_code,
+                                                       const kinematics::KinematicsQueryOptions &options) const
+{
+  return searchSolution(ik_pose, ik_seed_state, timeout, std::vector<double>(), solution, solution_callback, error_code);
+}
+
+bool OpenManipulatorKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                                                       const std::vector<double> &ik_seed_state,
+                                                       double timeout,
+                                                       const std::vector<double> &consistency_limits,
+                                                       std::vector<double> &solution,
+                                                       const IKCallbackFn &solution_callback,
+                                                       moveit_msgs::MoveItErrorCodes &error_code,
+                                                       const kinematics::KinematicsQueryOptions &options) const
+{
+  return searchSolution(ik_pose, ik_seed_state, timeout, consistency_limits, solution, solution_callback, error_code);
+}
+
+bool OpenManipulatorKinematicsPlugin::getPositionFK(const std::vector<std::string> &link_names,
+                                                    const std::vector<double> &joint_angles,
+                                                    std::vector<geometry_msgs::Pose> &poses) const
+{
+  if (active_ == false || joint_angles.size() != CHAIN_JOINT_NUM)
+    return false;
+
+  poses.resize(link_names.size());
+
+  for (std::size_t index = 0; index < link_names.size(); index++)
+  {
+    Eigen::Vector3d position;
+    Eigen::Matrix3d orientation;
+
+    if (link_names[index] == getTipFrame())
+    {
+      solver_.forward(&joint_angles[0], position, orientation);
+    }
+    else if (robot_model_->hasLinkModel(link_names[index]))
+    {
+      // Links other than the tip are rarely asked for, fall back to the full robot state
+      robot_state::RobotState state(robot_model_);
+      state.setToDefaultValues();
+      state.setJointGroupPositions(joint_model_group_, joint_angles);
+      state.update();
+
+      const Eigen::Affine3d link_pose = state.getGlobalLinkTransform(getBaseFrame()).inverse() *
+                                        state.getGlobalLinkTransform(link_names[index]);
+      position    = link_pose.translation();
+      orientation = link_pose.rotation();
+    }
+    else
+    {
+      ROS_ERROR_NAMED("open_manipulator_kinematics", "Unknown link '%s'", link_names[index].c_str());
+      return false;
+    }
+
+    poseEigenToMsg(position, orientation, poses[index]);
+  }
+
+  return true;
+}
+
+const std::vector<std::string> &OpenManipulatorKinematicsPlugin::getJointNames() const
+{
+  return joint_names_;
+}
+
+const std::vector<std::string> &OpenManipulatorKinematicsPlugin::getLinkNames() const
+{
+  return link_names_;
+}
+
+// registering kinematics plugin
+CLASS_LOADER_REGISTER_CLASS(open_manipulator_kinematics::OpenManipulatorKinematicsPlugin,
+                            kinematics::KinematicsBase);
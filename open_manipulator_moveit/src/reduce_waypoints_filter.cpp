@@ -0,0 +1,256 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <industrial_trajectory_filters/reduce_waypoints_filter.h>
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace industrial_trajectory_filters;
+
+const double DEFAULT_JOINT_TOLERANCE = 0.01;
+const double DEFAULT_CARTESIAN_TOLERANCE = 0.002;
+const double DEFAULT_VALIDATION_RESOLUTION = 0.05;
+
+ReduceWaypointsFilter::ReduceWaypointsFilter() :
+    TrajectoryFilterBase(), is_cartesian_(false), joint_tolerance_(DEFAULT_JOINT_TOLERANCE),
+    cartesian_tolerance_(DEFAULT_CARTESIAN_TOLERANCE), validate_(true),
+    validation_resolution_(DEFAULT_VALIDATION_RESOLUTION)
+{
+  filter_name_ = "ReduceWaypointsFilter";
+  filter_type_ = "ReduceWaypointsFilter";
+}
+
+bool ReduceWaypointsFilter::configure()
+{
+  std::string deviation;
+  nh_.param<std::string>("reduce_waypoints/deviation", deviation, "joint");
+  nh_.param<double>("reduce_waypoints/joint_tolerance", joint_tolerance_, DEFAULT_JOINT_TOLERANCE);
+  nh_.param<double>("reduce_waypoints/cartesian_tolerance", cartesian_tolerance_, DEFAULT_CARTESIAN_TOLERANCE);
+  nh_.param<bool>("reduce_waypoints/validate", validate_, true);
+  nh_.param<double>("reduce_waypoints/validation_resolution", validation_resolution_, DEFAULT_VALIDATION_RESOLUTION);
+  nh_.param<std::string>("reduce_waypoints/tip_link", tip_link_, "");
+
+  if (deviation != "joint" && deviation != "cartesian")
+  {
+    ROS_WARN_STREAM("ReduceWaypointsFilter, unknown deviation " << deviation << ", using joint");
+    deviation = "joint";
+  }
+  is_cartesian_ = (deviation == "cartesian");
+
+  if (validation_resolution_ <= 0.0)
+  {
+    ROS_WARN_STREAM("validation_resolution attribute not positive, setting to " << DEFAULT_VALIDATION_RESOLUTION);
+    validation_resolution_ = DEFAULT_VALIDATION_RESOLUTION;
+  }
+
+  ROS_INFO_STREAM("Reducing waypoints within " << (is_cartesian_ ? cartesian_tolerance_ : joint_tolerance_)
+                  << (is_cartesian_ ? " m" : " rad") << (validate_ ? ", validated in the planning scene" : ""));
+
+  return true;
+}
+
+bool ReduceWaypointsFilter::update(robot_trajectory::RobotTrajectory& trajectory)
+{
+  return reduce(trajectory, planning_scene::PlanningSceneConstPtr(), NULL);
+}
+
+bool ReduceWaypointsFilter::updateInScene(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                          const planning_interface::MotionPlanRequest& req,
+                                          robot_trajectory::RobotTrajectory& trajectory)
+{
+  return reduce(trajectory, validate_ ? planning_scene : planning_scene::PlanningSceneConstPtr(), &req);
+}
+
+double ReduceWaypointsFilter::getDeviation(const robot_trajectory::RobotTrajectory& trajectory, int first, int last,
+                                           int index)
+{
+  const double *first_position = trajectory.getWayPoint(first).getVariablePositions();
+  const double *last_position  = trajectory.getWayPoint(last).getVariablePositions();
+  const double *position       = trajectory.getWayPoint(index).getVariablePositions();
+
+  // Closest point of the segment in joint space
+  double segment_length = 0.0, projection = 0.0;
+  for (std::size_t i = 0; i < variable_index_.size(); i++)
+  {
+    const int variable = variable_index_[i];
+    const double segment = last_position[variable] - first_position[variable];
+
+    segment_length += segment * segment;
+    projection     += (position[variable] - first_position[variable]) * segment;
+  }
+
+  const double ratio = (segment_length > 1e-12) ? std::min(1.0, std::max(0.0, projection / segment_length)) : 0.0;
+
+  if (is_cartesian_)
+  {
+    trajectory.getWayPoint(first).interpolate(trajectory.getWayPoint(last), ratio, *segment_state_);
+    segment_state_->update();
+
+    return (segment_state_->getGlobalLinkTransform(segment_tip_link_).translation() - tip_position_[index]).norm();
+  }
+
+  double deviation = 0.0;
+  for (std::size_t i = 0; i < variable_index_.size(); i++)
+  {
+    const int variable = variable_index_[i];
+    const double segment_position = first_position[variable] + ratio * (last_position[variable] - first_position[variable]);
+
+    deviation = std::max(deviation, std::fabs(position[variable] - segment_position));
+  }
+
+  return deviation;
+}
+
+bool ReduceWaypointsFilter::isSegmentValid(const robot_trajectory::RobotTrajectory& trajectory, int first, int last,
+                                           const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                           const planning_interface::MotionPlanRequest& req)
+{
+  const double *first_position = trajectory.getWayPoint(first).getVariablePositions();
+  const double *last_position  = trajectory.getWayPoint(last).getVariablePositions();
+
+  double max_step = 0.0;
+  for (std::size_t i = 0; i < variable_index_.size(); i++)
+    max_step = std::max(max_step, std::fabs(last_position[variable_index_[i]] - first_position[variable_index_[i]]));
+
+  // The kept waypoints themselves were valid in the planned path
+  const int steps = (int)std::ceil(max_step / validation_resolution_);
+  for (int step = 1; step < steps; step++)
+  {
+    trajectory.getWayPoint(first).interpolate(trajectory.getWayPoint(last), double(step) / steps, *segment_state_);
+    segment_state_->update();
+
+    if (!planning_scene->isStateValid(*segment_state_, req.path_constraints, req.group_name))
+      return false;
+  }
+
+  return true;
+}
+
+bool ReduceWaypointsFilter::reduce(robot_trajectory::RobotTrajectory& trajectory,
+                                   const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                   const planning_interface::MotionPlanRequest* req)
+{
+  const int size_in = trajectory.getWayPointCount();
+  if (size_in <= 2)
+    return true;
+
+  const robot_model::JointModelGroup *group = trajectory.getGroup();
+  const robot_model::RobotModelConstPtr &robot_model = trajectory.getRobotModel();
+
+  if (group != NULL)
+  {
+    variable_index_ = group->getVariableIndexList();
+  }
+  else
+  {
+    variable_index_.resize(robot_model->getVariableCount());
+    for (std::size_t i = 0; i < variable_index_.size(); i++)
+      variable_index_[i] = i;
+  }
+
+  segment_state_.reset(new robot_state::RobotState(trajectory.getWayPoint(0)));
+
+  if (is_cartesian_)
+  {
+    segment_tip_link_ = (tip_link_.empty() && group != NULL) ? group->getLinkModelNames().back() : tip_link_;
+
+    if (!robot_model->hasLinkModel(segment_tip_link_))
+    {
+      ROS_ERROR_STREAM("ReduceWaypointsFilter, unknown tip link '" << segment_tip_link_ << "'");
+      return false;
+    }
+
+    tip_position_.resize(size_in);
+    for (int index = 0; index < size_in; index++)
+    {
+      *segment_state_ = trajectory.getWayPoint(index);
+      segment_state_->update();
+      tip_position_[index] = segment_state_->getGlobalLinkTransform(segment_tip_link_).translation();
+    }
+  }
+
+  const double tolerance = is_cartesian_ ? cartesian_tolerance_ : joint_tolerance_;
+
+  // Split the segments on a stack rather than recursively, long paths would go deep
+  std::vector<bool> is_kept(size_in, false);
+  std::vector<std::pair<int, int> > segments;
+
+  is_kept.front() = is_kept.back() = true;
+  segments.push_back(std::make_pair(0, size_in - 1));
+
+  while (!segments.empty())
+  {
+    const int first = segments.back().first;
+    const int last  = segments.back().second;
+    segments.pop_back();
+
+    if (last - first < 2)
+      continue;
+
+    int farthest = first + (last - first) / 2;
+    double max_deviation = -1.0;
+
+    for (int index = first + 1; index < last; index++)
+    {
+      const double deviation = getDeviation(trajectory, first, last, index);
+      if (deviation > max_deviation)
+      {
+        max_deviation = deviation;
+        farthest = index;
+      }
+    }
+
+    if (max_deviation <= tolerance &&
+        (!planning_scene || isSegmentValid(trajectory, first, last, planning_scene, *req)))
+      continue;
+
+    is_kept[farthest] = true;
+    segments.push_back(std::make_pair(first, farthest));
+    segments.push_back(std::make_pair(farthest, last));
+  }
+
+  std::vector<double> time_from_start(size_in);
+  double time = 0.0;
+  for (int index = 0; index < size_in; index++)
+  {
+    time += trajectory.getWayPointDurationFromPrevious(index);
+    time_from_start[index] = time;
+  }
+
+  robot_trajectory::RobotTrajectory trajectory_out(robot_model, trajectory.getGroupName());
+  int previous_index = 0;
+
+  for (int index = 0; index < size_in; index++)
+  {
+    if (!is_kept[index])
+      continue;
+
+    trajectory_out.addSuffixWayPoint(trajectory.getWayPoint(index), time_from_start[index] - time_from_start[previous_index]);
+    previous_index = index;
+  }
+
+  ROS_DEBUG_STREAM("Reduced trajectory from: " << size_in << " to: " << trajectory_out.getWayPointCount());
+
+  trajectory.swap(trajectory_out);
+  return true;
+}
+
+// registering planner adapter
+CLASS_LOADER_REGISTER_CLASS(industrial_trajectory_filters::ReduceWaypointsFilter,
+                            planning_request_adapter::PlanningRequestAdapter);
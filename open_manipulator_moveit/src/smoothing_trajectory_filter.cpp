@@ -38,6 +38,9 @@
 #include <console_bridge/console.h>
 #include <moveit/robot_state/conversions.h>
 #include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <Eigen/QR>
 
 #include <ros/ros.h>
 #include <ros/console.h>
@@ -48,10 +51,13 @@ namespace industrial_trajectory_filters
   SmoothingTrajectoryFilter::SmoothingTrajectoryFilter()
   {
       initialized_ = false;
+      is_savitzky_golay_ = false;
   }
 
   bool SmoothingTrajectoryFilter::init(std::vector<double> &coef)
   {
+    is_savitzky_golay_ = false;
+    coef_.clear();
     if(coef.size()%2 == 1) {		// smoothing filters must have an odd number of coefficients
       initialized_ = true;
       num_coef_ = coef.size();
@@ -69,6 +75,39 @@ namespace industrial_trajectory_filters
     }
   }
 
+  bool SmoothingTrajectoryFilter::initSavitzkyGolay(int window, int order)
+  {
+    initialized_ = false;
+    is_savitzky_golay_ = false;
+    if(window%2 == 0 || order < 2 || order >= window) return(false);
+
+    // Least squares fit of the window, sample k at offset k-half: the rows of the pseudo
+    // inverse give the polynomial coefficients, i.e. the value and derivatives at the center
+    const int half = window/2;
+    Eigen::MatrixXd vandermonde(window, order+1);
+    for(int k=0; k<window; k++){
+      for(int i=0; i<=order; i++){
+	vandermonde(k,i) = std::pow(double(k-half), i);
+      }
+    }
+    const Eigen::MatrixXd fit = vandermonde.colPivHouseholderQr().solve(Eigen::MatrixXd::Identity(window, window));
+
+    coef_.resize(window);
+    velocity_coef_.resize(window);
+    acceleration_coef_.resize(window);
+    for(int k=0; k<window; k++){
+      coef_[k] = fit(0,k);
+      velocity_coef_[k] = fit(1,k);
+      acceleration_coef_[k] = 2.0*fit(2,k);
+    }
+
+    num_coef_ = window;
+    gain_ = 1.0;		// the position kernel of a fit already has unity gain
+    initialized_ = true;
+    is_savitzky_golay_ = true;
+    return(true);
+  }
+
   SmoothingTrajectoryFilter::~SmoothingTrajectoryFilter()
   {
     coef_.clear();
@@ -81,53 +120,141 @@ namespace industrial_trajectory_filters
     const int num_points = rob_trajectory.getWayPointCount(); 
     if(num_points <=2) return(false); // nothing to do here, can't change either first or last point
     const int num_states = rob_trajectory.getWayPoint(0).getVariableCount();
-    std::vector<double> xv;
-    
-    // filter each variable independently
-    for(int i=0; i<num_states; i++){ 
-      double start_value     = rob_trajectory.getWayPoint(0).getVariablePosition(i);
-      double start_slope     = rob_trajectory.getWayPoint(1).getVariablePosition(i) - start_value; // slope at start
-      double end_value      = rob_trajectory.getWayPoint(num_points-1).getVariablePosition(i);
-      double end_slope      = end_value - rob_trajectory.getWayPoint(num_points-2).getVariablePosition(i); // slope at end
- 
-      // initialize the filter to have initial slope
-      xv.clear();
-      double value = start_value - (num_coef_/2)*start_slope;
-      for(int j=0; j<num_coef_; j++) { 
-	xv.push_back(value);
-	value += start_slope;
-      }
-      
-      // cycle through every waypoint, and apply the filter, NOTE, 1st and last waypoints should not be changed
+
+    WayPointMatrix positions(num_points, num_states);
+    for(int j=0; j<num_points; j++){
+      positions.row(j) = Eigen::Map<const Eigen::RowVectorXd>(rob_trajectory.getWayPoint(j).getVariablePositions(), num_states);
+    }
+
+    if(!is_savitzky_golay_){
+      applyFilter(positions);
+
+      // save the results
       for(int j=1; j<num_points-1; j++){
-	// shift backwards
-	for(int k=0; k<num_coef_-1; k++){
-	  xv[k] = xv[k+1];  
-	}
-	
-	// get next input to filter which is num_coef/2 in front of current point being smoothed
-	if(j+num_coef_/2 < num_points){	
-	  xv[num_coef_ - 1] = rob_trajectory.getWayPoint(j+num_coef_/2).getVariablePosition(i); // i'th state of j'th waypoint
-	}
-	else{
-	  end_value += end_slope;
-	  xv[num_coef_-1] = end_value; // fill by continuing with final slope
-	}
-	// apply the filter
-	double sum = 0.0;
-	for(int k=0; k<num_coef_; k++){ 
-	  sum += xv[k]*coef_[k];
-	}
-
-	// save the results
-	rob_trajectory.getWayPointPtr(j)->setVariablePosition(i,sum/gain_); // j'th waypoint, i'th variable set to output value
-
-      }// end for every waypoint
-
-    } // end for every state
+	rob_trajectory.getWayPointPtr(j)->setVariablePositions(positions.row(j).data()); // j'th waypoint, all variables
+      }
+      return(true);
+    }
+
+    WayPointMatrix velocities(num_points, num_states);
+    WayPointMatrix accelerations(num_points, num_states);
+    applyFilter(positions, velocities, accelerations);
+
+    // the derivatives are per waypoint step, scaled by the local step of a timed trajectory
+    bool is_timed = true;
+    for(int j=1; j<num_points; j++){
+      if(rob_trajectory.getWayPointDurationFromPrevious(j) <= 0.0) is_timed = false;
+    }
+
+    for(int j=1; j<num_points-1; j++){
+      robot_state::RobotStatePtr state = rob_trajectory.getWayPointPtr(j);
+      state->setVariablePositions(positions.row(j).data());
+
+      if(is_timed){
+	const double dt = 0.5*(rob_trajectory.getWayPointDurationFromPrevious(j) + rob_trajectory.getWayPointDurationFromPrevious(j+1));
+	velocities.row(j) /= dt;
+	accelerations.row(j) /= dt*dt;
+	state->setVariableVelocities(velocities.row(j).data());
+	state->setVariableAccelerations(accelerations.row(j).data());
+      }
+    }
 
     return(true);
 
 }// end SmoothingTrajectoryFilter::applyfilter()
 
+ bool SmoothingTrajectoryFilter::applyFilter(WayPointMatrix& positions) const
+  {
+    if(!initialized_) return(false);
+
+    const int num_points = positions.rows();
+    if(num_points <=2) return(false); // nothing to do here, can't change either first or last point
+
+    WayPointMatrix xv;
+    extendWayPoints(positions, xv);
+
+    // apply the filter to all variables at once, NOTE, 1st and last waypoints should not be changed.
+    WayPointMatrix sum;
+    convolve(xv, coef_, sum);
+    positions.middleRows(1, num_points-2) = sum/gain_;
+
+    return(true);
+
+}// end SmoothingTrajectoryFilter::applyfilter()
+
+ bool SmoothingTrajectoryFilter::applyFilter(WayPointMatrix& positions, WayPointMatrix& velocities,
+                                             WayPointMatrix& accelerations) const
+  {
+    if(!initialized_ || !is_savitzky_golay_) return(false);
+
+    const int num_points = positions.rows();
+    if(num_points <=2) return(false); // nothing to do here, can't change either first or last point
+
+    // the three kernels run over the same extended copy, so they evaluate one fit per waypoint
+    WayPointMatrix xv;
+    extendWayPoints(positions, xv);
+
+    WayPointMatrix sum;
+    velocities.resize(num_points, positions.cols());
+    accelerations.resize(num_points, positions.cols());
+
+    convolve(xv, velocity_coef_, sum);
+    velocities.middleRows(1, num_points-2) = sum;
+    convolve(xv, acceleration_coef_, sum);
+    accelerations.middleRows(1, num_points-2) = sum;
+    convolve(xv, coef_, sum);
+    positions.middleRows(1, num_points-2) = sum;
+
+    // the end waypoints are kept, so are their derivatives along the end slopes
+    velocities.row(0) = positions.row(1) - positions.row(0);
+    velocities.row(num_points-1) = positions.row(num_points-1) - positions.row(num_points-2);
+    accelerations.row(0).setZero();
+    accelerations.row(num_points-1).setZero();
+
+    return(true);
+
+}// end SmoothingTrajectoryFilter::applyfilter()
+
+ void SmoothingTrajectoryFilter::extendWayPoints(const WayPointMatrix& positions, WayPointMatrix& xv) const
+  {
+    const int num_points = positions.rows();
+    const int num_states = positions.cols();
+    const int half = num_coef_/2;
+
+    // Time major copy extended by half the kernel on both sides (row m+half holds index m)
+    xv.resize(num_points + 2*half, num_states);
+
+    const Eigen::RowVectorXd start_value = positions.row(0);
+    const Eigen::RowVectorXd end_value = positions.row(num_points-1);
+    const Eigen::RowVectorXd start_slope = positions.row(1) - start_value;
+    const Eigen::RowVectorXd end_slope = end_value - positions.row(num_points-2);
+
+    // The filter starts with a window on the initial slope, which also stands in for the
+    // first half window of waypoints; past the end it continues with the final slope from
+    // the first index read beyond the window (later than num_points for very short trajectories).
+    // A Savitzky-Golay fit keeps all the waypoints, it only extends beyond both ends.
+    const int start_end = is_savitzky_golay_ ? 0 : half;
+    const int end_start = is_savitzky_golay_ ? num_points : std::max(num_points, half+1);
+    for(int m=-half; m<num_points+half; m++){
+      if(m <= start_end)
+	xv.row(m+half) = start_value + m*start_slope;
+      else if(m < num_points)
+	xv.row(m+half) = positions.row(m);
+      else
+	xv.row(m+half) = end_value + (m-end_start+1)*end_slope;
+    }
+  }
+
+ void SmoothingTrajectoryFilter::convolve(const WayPointMatrix& xv, const std::vector<double>& coef,
+                                          WayPointMatrix& output) const
+  {
+    // Output j is sum_k coef[k]*x[j-half+k], i.e. each coefficient scales one contiguous block of rows
+    const int num_points = xv.rows() - 2*(num_coef_/2);
+
+    output.noalias() = coef[0]*xv.middleRows(1, num_points-2);
+    for(int k=1; k<num_coef_; k++){
+      output.noalias() += coef[k]*xv.middleRows(1+k, num_points-2);
+    }
+  }
+
 }  // end namespace 
@@ -0,0 +1,228 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Compares the iterative parabolic time parameterization of the current adapter chain with
+// the jerk limited one on the same OMPL paths between random valid states of the arm group.
+//
+// ROS parameters (private):
+// - paths (default = 100)
+// - planning_time (default = 1.0 sec)
+// - group (default = arm)
+// - velocity_scale, acceleration_scale (default = 1.0)
+// - planning_plugin, request_adapters (the launch file leaves out the time parameterization)
+
+#include <ros/ros.h>
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <random_numbers/random_numbers.h>
+
+#include "open_manipulator_planning_adapters/jerk_limited_trajectory_timing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+typedef struct
+{
+  uint32_t success;
+  double   duration;           // sec, sum over the paths
+  double   compute_time;       // sec, sum over the paths
+  double   max_acceleration_ratio;
+  double   max_jerk_ratio;
+} BenchmarkResult;
+
+static robot_trajectory::RobotTrajectoryPtr copyTrajectory(const robot_trajectory::RobotTrajectory &trajectory)
+{
+  // The copy constructor shares the waypoints, the methods must not see each other's timing
+  robot_trajectory::RobotTrajectoryPtr copy(new robot_trajectory::RobotTrajectory(trajectory.getRobotModel(), trajectory.getGroupName()));
+
+  for (std::size_t point = 0; point < trajectory.getWayPointCount(); point++)
+    copy->addSuffixWayPoint(robot_state::RobotState(trajectory.getWayPoint(point)), 0.0);
+
+  return copy;
+}
+
+static void evaluateTrajectory(const robot_trajectory::RobotTrajectory &trajectory,
+                               const std::vector<open_manipulator_planning_adapters::JointLimit> &limits,
+                               BenchmarkResult &result)
+{
+  // Accelerations of the waypoints against the limits, the jerk from their differences
+  const std::vector<int> &variable_index = trajectory.getGroup()->getVariableIndexList();
+
+  for (std::size_t point = 0; point < trajectory.getWayPointCount(); point++)
+  {
+    const double dt = trajectory.getWayPointDurationFromPrevious(point);
+
+    for (std::size_t joint = 0; joint < variable_index.size(); joint++)
+    {
+      const double acceleration = trajectory.getWayPoint(point).getVariableAcceleration(variable_index[joint]);
+      result.max_acceleration_ratio = std::max(result.max_acceleration_ratio, std::fabs(acceleration) / limits[joint].max_acceleration);
+
+      if (point == 0 || dt <= 0.0)
+        continue;
+
+      const double previous_acceleration = trajectory.getWayPoint(point - 1).getVariableAcceleration(variable_index[joint]);
+      result.max_jerk_ratio = std::max(result.max_jerk_ratio, std::fabs(acceleration - previous_acceleration) / dt / limits[joint].max_jerk);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "open_manipulator_time_parameterization_benchmark");
+  ros::NodeHandle nh;
+  ros::NodeHandle priv_nh("~");
+
+  int paths = priv_nh.param<int>("paths", 100);
+  double planning_time = priv_nh.param<double>("planning_time", 1.0);
+  double velocity_scale = priv_nh.param<double>("velocity_scale", 1.0);
+  double acceleration_scale = priv_nh.param<double>("acceleration_scale", 1.0);
+  std::string group_name = priv_nh.param<std::string>("group", "arm");
+
+  robot_model_loader::RobotModelLoader robot_model_loader("robot_description", false);
+  robot_model::RobotModelPtr robot_model = robot_model_loader.getModel();
+
+  if (!robot_model)
+  {
+    ROS_ERROR("Robot model is not loaded");
+    return 1;
+  }
+
+  const robot_model::JointModelGroup *joint_model_group = robot_model->getJointModelGroup(group_name);
+  planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model));
+  planning_pipeline::PlanningPipeline planning_pipeline(robot_model, priv_nh, "planning_plugin", "request_adapters");
+
+  // Limits as the timing reads them, to check both methods against the same numbers
+  const std::vector<std::string> &variable_names = joint_model_group->getVariableNames();
+  std::vector<open_manipulator_planning_adapters::JointLimit> limits(variable_names.size());
+
+  for (std::size_t index = 0; index < variable_names.size(); index++)
+  {
+    const std::string prefix = "robot_description_planning/joint_limits/" + variable_names[index] + "/";
+
+    nh.param<double>(prefix + "max_velocity",     limits[index].max_velocity,     1.0);
+    nh.param<double>(prefix + "max_acceleration", limits[index].max_acceleration, 1.0);
+    nh.param<double>(prefix + "max_jerk",         limits[index].max_jerk,         5.0);
+  }
+
+  // Fixed set of paths: random valid start and goal states from a seeded engine, planned once
+  random_numbers::RandomNumberGenerator rng(0);
+  robot_state::RobotState start_state(robot_model);
+  robot_state::RobotState goal_state(robot_model);
+  start_state.setToDefaultValues();
+  goal_state.setToDefaultValues();
+
+  std::vector<robot_trajectory::RobotTrajectoryPtr> planned_paths;
+  int attempts = 0;
+
+  while ((int)planned_paths.size() < paths && attempts < 10 * paths && ros::ok())
+  {
+    attempts++;
+
+    start_state.setToRandomPositions(joint_model_group, rng);
+    goal_state.setToRandomPositions(joint_model_group, rng);
+    start_state.update();
+    goal_state.update();
+
+    if (!planning_scene->isStateValid(start_state, group_name) || !planning_scene->isStateValid(goal_state, group_name))
+      continue;
+
+    planning_interface::MotionPlanRequest req;
+    planning_interface::MotionPlanResponse res;
+
+    req.group_name = group_name;
+    req.allowed_planning_time = planning_time;
+    robot_state::robotStateToRobotStateMsg(start_state, req.start_state);
+    req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(goal_state, joint_model_group));
+
+    if (planning_pipeline.generatePlan(planning_scene, req, res) && res.trajectory_ && res.trajectory_->getWayPointCount() > 1)
+      planned_paths.push_back(res.trajectory_);
+  }
+
+  ROS_INFO("Time parameterization benchmark: %zu paths, group '%s', velocity scale %.2f, acceleration scale %.2f",
+           planned_paths.size(), group_name.c_str(), velocity_scale, acceleration_scale);
+
+  if (planned_paths.empty())
+    return 1;
+
+  trajectory_processing::IterativeParabolicTimeParameterization iterative_parabolic;
+  open_manipulator_planning_adapters::JerkLimitedTrajectoryTiming jerk_limited;
+
+  BenchmarkResult iterative_parabolic_result = {0, 0.0, 0.0, 0.0, 0.0};
+  BenchmarkResult jerk_limited_result = {0, 0.0, 0.0, 0.0, 0.0};
+  double speed_up = 0.0;
+
+  for (std::size_t index = 0; index < planned_paths.size(); index++)
+  {
+    robot_trajectory::RobotTrajectoryPtr parabolic_path = copyTrajectory(*planned_paths[index]);
+    robot_trajectory::RobotTrajectoryPtr jerk_limited_path = copyTrajectory(*planned_paths[index]);
+
+    ros::WallTime start_time = ros::WallTime::now();
+    bool is_parabolic_timed = iterative_parabolic.computeTimeStamps(*parabolic_path, velocity_scale, acceleration_scale);
+    iterative_parabolic_result.compute_time += (ros::WallTime::now() - start_time).toSec();
+
+    start_time = ros::WallTime::now();
+    bool is_jerk_limited_timed = jerk_limited.computeTimeStamps(*jerk_limited_path, velocity_scale, acceleration_scale);
+    jerk_limited_result.compute_time += (ros::WallTime::now() - start_time).toSec();
+
+    if (!is_parabolic_timed || !is_jerk_limited_timed)
+      continue;
+
+    const double parabolic_duration    = parabolic_path->getWaypointDurationFromStart(parabolic_path->getWayPointCount() - 1);
+    const double jerk_limited_duration = jerk_limited_path->getWaypointDurationFromStart(jerk_limited_path->getWayPointCount() - 1);
+
+    iterative_parabolic_result.success++;
+    iterative_parabolic_result.duration += parabolic_duration;
+    evaluateTrajectory(*parabolic_path, limits, iterative_parabolic_result);
+
+    jerk_limited_result.success++;
+    jerk_limited_result.duration += jerk_limited_duration;
+    evaluateTrajectory(*jerk_limited_path, limits, jerk_limited_result);
+
+    if (jerk_limited_duration > 0.0)
+      speed_up += parabolic_duration / jerk_limited_duration;
+  }
+
+  const BenchmarkResult *results[] = { &iterative_parabolic_result, &jerk_limited_result };
+  const char *names[] = { "IterativeParabolicTimeParameterization", "JerkLimitedTimeParameterization" };
+
+  for (int index = 0; index < 2; index++)
+  {
+    const BenchmarkResult &result = *results[index];
+
+    ROS_INFO("%-40s timed %4u, mean duration %7.3f sec, %9.2f us/path, max acceleration %.2f, max jerk %.2f (of the limits)",
+             names[index],
+             result.success,
+             result.duration / std::max(1u, result.success),
+             1e6 * result.compute_time / planned_paths.size(),
+             result.max_acceleration_ratio,
+             result.max_jerk_ratio);
+  }
+
+  ROS_INFO("Mean duration ratio (iterative parabolic / jerk limited) %.3f",
+           speed_up / std::max(1u, jerk_limited_result.success));
+
+  return 0;
+}
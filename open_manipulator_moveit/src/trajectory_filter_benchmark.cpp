@@ -0,0 +1,298 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Runs the industrial_trajectory_filters adapters on synthetic trajectories of serial chains
+// with 4 to 7 joints, from min_points to max_points waypoints by decades, and reports the
+// time and heap allocations per input waypoint of each adapter.
+//
+// The filters read their parameters from the private namespace of this node, as they do
+// from move_group. The trajectories of 1,000,000 waypoints take a few GB (every waypoint
+// is a RobotState), lower max_points on small machines.
+//
+// ROS parameters (private):
+// - min_points (default = 10)
+// - max_points (default = 1000000)
+// - min_joints, max_joints (default = 4, 7)
+// - filters (default = all the industrial_trajectory_filters adapters)
+
+#include <ros/ros.h>
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+
+#include <pluginlib/class_loader.h>
+#include <urdf/model.h>
+#include <srdfdom/model.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Heap allocations of the benchmark thread only, the ROS threads keep allocating meanwhile
+static thread_local bool is_counting = false;
+static thread_local uint64_t allocation_count = 0;
+static thread_local uint64_t allocation_bytes = 0;
+
+void *operator new(std::size_t size)
+{
+  if (is_counting)
+  {
+    allocation_count++;
+    allocation_bytes += size;
+  }
+
+  void *memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == NULL)
+    throw std::bad_alloc();
+
+  return memory;
+}
+
+void *operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *memory) throw()
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory) throw()
+{
+  std::free(memory);
+}
+
+typedef struct
+{
+  double   filter_time;        // sec, sum over the repeats
+  uint64_t allocations;        // sum over the repeats
+  uint64_t bytes;              // sum over the repeats
+  uint32_t failure;
+  std::size_t output_points;
+} BenchmarkResult;
+
+static robot_model::RobotModelPtr createChainModel(int joints)
+{
+  // Serial chain of revolute joints with alternating axes, the arm group spans all of them
+  std::ostringstream urdf_xml;
+  urdf_xml << "<robot name=\"benchmark_chain\"><link name=\"link0\"/>";
+
+  for (int joint = 1; joint <= joints; joint++)
+  {
+    urdf_xml << "<link name=\"link" << joint << "\"/>"
+             << "<joint name=\"joint" << joint << "\" type=\"revolute\">"
+             << "<parent link=\"link" << joint - 1 << "\"/><child link=\"link" << joint << "\"/>"
+             << "<origin xyz=\"0 0 0.1\" rpy=\"0 0 0\"/>"
+             << "<axis xyz=\"0 " << (joint % 2 ? "0 1" : "1 0") << "\"/>"
+             << "<limit lower=\"-3.14\" upper=\"3.14\" effort=\"1.0\" velocity=\"4.8\"/>"
+             << "</joint>";
+  }
+  urdf_xml << "</robot>";
+
+  std::ostringstream srdf_xml;
+  srdf_xml << "<robot name=\"benchmark_chain\"><group name=\"arm\">"
+           << "<chain base_link=\"link0\" tip_link=\"link" << joints << "\"/>"
+           << "</group></robot>";
+
+  urdf::Model *urdf_model = new urdf::Model();
+  urdf::ModelInterfaceSharedPtr urdf_model_ptr(urdf_model);
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+
+  if (!urdf_model->initString(urdf_xml.str()) || !srdf_model->initString(*urdf_model, srdf_xml.str()))
+    return robot_model::RobotModelPtr();
+
+  return robot_model::RobotModelPtr(new robot_model::RobotModel(urdf_model_ptr, srdf_model));
+}
+
+static robot_trajectory::RobotTrajectoryPtr createTrajectory(const robot_model::RobotModelPtr &robot_model,
+                                                             std::size_t points)
+{
+  // Sines of different frequencies per joint, 10 ms apart, with their analytic derivatives
+  const double dt = 0.01;
+  const robot_model::JointModelGroup *joint_model_group = robot_model->getJointModelGroup("arm");
+  const std::vector<int> &variable_index = joint_model_group->getVariableIndexList();
+
+  robot_trajectory::RobotTrajectoryPtr trajectory(new robot_trajectory::RobotTrajectory(robot_model, "arm"));
+  robot_state::RobotState state(robot_model);
+  state.setToDefaultValues();
+
+  for (std::size_t point = 0; point < points; point++)
+  {
+    const double time = point * dt;
+
+    for (std::size_t joint = 0; joint < variable_index.size(); joint++)
+    {
+      const double frequency = 2.0 * M_PI * 0.1 * (joint + 1);
+      const double phase = frequency * time + 0.5 * joint;
+
+      state.setVariablePosition(variable_index[joint], 0.5 * std::sin(phase));
+      state.setVariableVelocity(variable_index[joint], 0.5 * frequency * std::cos(phase));
+      state.setVariableAcceleration(variable_index[joint], -0.5 * frequency * frequency * std::sin(phase));
+    }
+
+    trajectory->addSuffixWayPoint(state, (point == 0) ? 0.0 : dt);
+  }
+
+  return trajectory;
+}
+
+static robot_trajectory::RobotTrajectoryPtr copyTrajectory(const robot_trajectory::RobotTrajectory &trajectory)
+{
+  // The copy constructor shares the waypoints, every run must filter its own
+  robot_trajectory::RobotTrajectoryPtr copy(new robot_trajectory::RobotTrajectory(trajectory.getRobotModel(), trajectory.getGroupName()));
+
+  for (std::size_t point = 0; point < trajectory.getWayPointCount(); point++)
+    copy->addSuffixWayPoint(robot_state::RobotState(trajectory.getWayPoint(point)),
+                            trajectory.getWayPointDurationFromPrevious(point));
+
+  return copy;
+}
+
+static bool returnTrajectory(const robot_trajectory::RobotTrajectoryPtr &trajectory,
+                             const planning_scene::PlanningSceneConstPtr &planning_scene,
+                             const planning_interface::MotionPlanRequest &req,
+                             planning_interface::MotionPlanResponse &res)
+{
+  // Stands in for the planner, hands over the prepared trajectory without copying
+  res.trajectory_ = trajectory;
+  res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "industrial_trajectory_filters_benchmark");
+  ros::NodeHandle priv_nh("~");
+
+  int min_points = priv_nh.param<int>("min_points", 10);
+  int max_points = priv_nh.param<int>("max_points", 1000000);
+  int min_joints = priv_nh.param<int>("min_joints", 4);
+  int max_joints = priv_nh.param<int>("max_joints", 7);
+
+  // The sizes step by decades from at least two waypoints
+  min_points = std::max(2, min_points);
+
+  std::vector<std::string> filter_names;
+  if (!priv_nh.getParam("filters", filter_names))
+  {
+    filter_names.push_back("industrial_trajectory_filters/NPointFilter");
+    filter_names.push_back("industrial_trajectory_filters/NPointFilterMsg");
+    filter_names.push_back("industrial_trajectory_filters/UniformSampleFilter");
+    filter_names.push_back("industrial_trajectory_filters/UniformSampleFilterMsg");
+    filter_names.push_back("industrial_trajectory_filters/AddSmoothingFilter");
+    filter_names.push_back("industrial_trajectory_filters/AddFusedTrajectoryFilter");
+    filter_names.push_back("industrial_trajectory_filters/ReduceWaypointsFilter");
+  }
+
+  pluginlib::ClassLoader<planning_request_adapter::PlanningRequestAdapter>
+      adapter_loader("moveit_core", "planning_request_adapter::PlanningRequestAdapter");
+  std::vector<planning_request_adapter::PlanningRequestAdapterPtr> filters;
+
+  for (std::size_t index = 0; index < filter_names.size(); index++)
+  {
+    try
+    {
+      filters.push_back(planning_request_adapter::PlanningRequestAdapterPtr(
+                          adapter_loader.createUnmanagedInstance(filter_names[index])));
+    }
+    catch (pluginlib::PluginlibException &ex)
+    {
+      ROS_ERROR("Failed to load %s: %s", filter_names[index].c_str(), ex.what());
+      return 1;
+    }
+  }
+
+  ROS_INFO("Trajectory filter benchmark: %d to %d waypoints, %d to %d joints, %zu filters",
+           min_points, max_points, min_joints, max_joints, filters.size());
+
+  for (int joints = min_joints; joints <= max_joints && ros::ok(); joints++)
+  {
+    robot_model::RobotModelPtr robot_model = createChainModel(joints);
+    if (!robot_model)
+    {
+      ROS_ERROR("Failed to build the %d joint benchmark chain", joints);
+      return 1;
+    }
+
+    planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model));
+    planning_interface::MotionPlanRequest req;
+    req.group_name = "arm";
+    req.max_velocity_scaling_factor = 1.0;
+    req.max_acceleration_scaling_factor = 1.0;
+
+    for (int points = min_points; points <= max_points && ros::ok(); points *= 10)
+    {
+      robot_trajectory::RobotTrajectoryPtr trajectory = createTrajectory(robot_model, points);
+
+      // About 100000 waypoints per filter and size, enough repeats for the short ones
+      const int repeats = std::max(1, std::min(1000, 100000 / points));
+
+      for (std::size_t index = 0; index < filters.size(); index++)
+      {
+        BenchmarkResult result = {0.0, 0, 0, 0, 0};
+
+        for (int repeat = 0; repeat < repeats; repeat++)
+        {
+          robot_trajectory::RobotTrajectoryPtr input = copyTrajectory(*trajectory);
+          planning_interface::MotionPlanResponse res;
+          std::vector<std::size_t> added_path_index;
+
+          allocation_count = 0;
+          allocation_bytes = 0;
+          is_counting = true;
+
+          ros::WallTime start_time = ros::WallTime::now();
+          bool filtered = filters[index]->adaptAndPlan(boost::bind(&returnTrajectory, input, _1, _2, _3),
+                                                       planning_scene, req, res, added_path_index);
+          result.filter_time += (ros::WallTime::now() - start_time).toSec();
+
+          is_counting = false;
+          result.allocations += allocation_count;
+          result.bytes += allocation_bytes;
+
+          if (!filtered || !res.trajectory_)
+            result.failure++;
+          else
+            result.output_points = res.trajectory_->getWayPointCount();
+        }
+
+        const double samples = double(points) * repeats;
+
+        ROS_INFO("%-55s %d joints %8d points: %10.3f us/point, %8.2f allocations/point, %10.1f bytes/point, "
+                 "%8zu points out%s",
+                 filter_names[index].c_str(), joints, points,
+                 1e6 * result.filter_time / samples,
+                 result.allocations / samples,
+                 result.bytes / samples,
+                 result.output_points,
+                 result.failure ? " (failed)" : "");
+      }
+    }
+  }
+
+  filters.clear();
+  return 0;
+}
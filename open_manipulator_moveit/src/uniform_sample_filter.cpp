@@ -30,7 +30,6 @@
  */
 
 #include <industrial_trajectory_filters/uniform_sample_filter.h>
-#include <kdl/velocityprofile_spline.hpp>
 #include <ros/ros.h>
 
 using namespace industrial_trajectory_filters;
@@ -67,154 +66,237 @@ template<typename T>
 template<typename T>
   bool UniformSampleFilter<T>::update(const T& trajectory_in, T& trajectory_out)
   {
-    bool success = false;
-    size_t size_in = trajectory_in.request.trajectory.points.size();
-    double duration_in = trajectory_in.request.trajectory.points.back().time_from_start.toSec();
-    double interpolated_time = 0.0;
-    size_t index_in = 0;
+    const std::vector<trajectory_msgs::JointTrajectoryPoint> & points_in = trajectory_in.request.trajectory.points;
+    size_t size_in = points_in.size();
 
-    trajectory_msgs::JointTrajectoryPoint p1, p2, interp_pt;
+    if (size_in < 2 || sample_duration_ <= 0.0)
+    {
+      trajectory_out = trajectory_in;
+      return true;
+    }
 
-    trajectory_out = trajectory_in;
+    size_t joint_num = points_in.front().positions.size();
+    for (size_t index_in = 0; index_in < size_in; ++index_in)
+    {
+      const trajectory_msgs::JointTrajectoryPoint & pt = points_in[index_in];
+      if (pt.positions.size() != joint_num || pt.velocities.size() != joint_num || pt.accelerations.size() != joint_num)
+      {
+        ROS_ERROR_STREAM(
+            "Trajectory point " << index_in << " not fully defined, pos: " << pt.positions.size() << " vel: " << pt.velocities.size() << " acc: " << pt.accelerations.size() << ", expected: " << joint_num);
+        return false;
+      }
+    }
+
+    double duration_in = points_in.back().time_from_start.toSec();
 
-    // Clear out the trajectory points
+    // Samples at 0, dt, ... while before the end, then the last input point (timed at the next sample)
+    size_t sample_num = 0;
+    while (sample_num * sample_duration_ < duration_in)
+      sample_num++;
+
+    // Copy everything but the points, then size the output once
     trajectory_out.request.trajectory.points.clear();
+    trajectory_out.request.trajectory.header = trajectory_in.request.trajectory.header;
+    trajectory_out.request.trajectory.joint_names = trajectory_in.request.trajectory.joint_names;
+
+    std::vector<trajectory_msgs::JointTrajectoryPoint> & points_out = trajectory_out.request.trajectory.points;
+    points_out.resize(sample_num + 1);
+    for (size_t index_out = 0; index_out < sample_num; ++index_out)
+    {
+      points_out[index_out].positions.resize(joint_num);
+      points_out[index_out].velocities.resize(joint_num);
+      points_out[index_out].accelerations.resize(joint_num);
+    }
+
+    size_t index_in = 0;
+    const trajectory_msgs::JointTrajectoryPoint * p1 = &points_in[0];
+    const trajectory_msgs::JointTrajectoryPoint * p2 = &points_in[1];
+    segment_.fit(p1->positions.data(), p1->velocities.data(), p1->accelerations.data(),
+                 p2->positions.data(), p2->velocities.data(), p2->accelerations.data(),
+                 joint_num, p2->time_from_start.toSec() - p1->time_from_start.toSec());
 
-    while (interpolated_time < duration_in)
+    for (size_t index_out = 0; index_out < sample_num; ++index_out)
     {
-      ROS_INFO_STREAM("Interpolated time: " << interpolated_time);
-      // Increment index until the interpolated time is past the start time.
-      while (interpolated_time > trajectory_in.request.trajectory.points[index_in + 1].time_from_start.toSec())
+      double interpolated_time = index_out * sample_duration_;
+
+      // Move the cursor until the segment contains the sample, refitting only when it moves
+      bool is_moved = false;
+      while (index_in + 2 < size_in && interpolated_time > points_in[index_in + 1].time_from_start.toSec())
       {
-        ROS_INFO_STREAM(
-            "Interpolated time: " << interpolated_time << ", next point time: " << (trajectory_in.request.trajectory.points[index_in + 1].time_from_start.toSec()));
-        ROS_INFO_STREAM("Incrementing index");
         index_in++;
-        if (index_in >= size_in)
-        {
-          ROS_ERROR_STREAM(
-              "Programming error, index: " << index_in << ", greater(or equal) to size: " << size_in << " input duration: " << duration_in << " interpolated time:)" << interpolated_time);
-          return false;
-        }
+        is_moved = true;
       }
-      p1 = trajectory_in.request.trajectory.points[index_in];
-      p2 = trajectory_in.request.trajectory.points[index_in + 1];
-      if (!interpolatePt(p1, p2, interpolated_time, interp_pt))
+      if (is_moved)
       {
-        ROS_ERROR_STREAM("Failed to interpolate point");
-        return false;
+        p1 = &points_in[index_in];
+        p2 = &points_in[index_in + 1];
+        segment_.fit(p1->positions.data(), p1->velocities.data(), p1->accelerations.data(),
+                     p2->positions.data(), p2->velocities.data(), p2->accelerations.data(),
+                     joint_num, p2->time_from_start.toSec() - p1->time_from_start.toSec());
       }
-      trajectory_out.request.trajectory.points.push_back(interp_pt);
-      interpolated_time += sample_duration_;
 
+      trajectory_msgs::JointTrajectoryPoint & interp_pt = points_out[index_out];
+      segment_.sample(interpolated_time - p1->time_from_start.toSec(),
+                      interp_pt.positions.data(), interp_pt.velocities.data(), interp_pt.accelerations.data());
+      interp_pt.time_from_start = ros::Duration(interpolated_time);
     }
 
-    ROS_INFO_STREAM(
-        "Interpolated time exceeds original trajectory (quitting), original: " << duration_in << " final interpolated time: " << interpolated_time);
-    p2 = trajectory_in.request.trajectory.points.back();
-    p2.time_from_start = ros::Duration(interpolated_time);
     // TODO: Really should check that appending the last point doesn't result in
     // really slow motion at the end.  This could happen if the sample duration is a
     // large percentage of the trajectory duration (not likely).
-    trajectory_out.request.trajectory.points.push_back(p2);
+    points_out.back() = points_in.back();
+    points_out.back().time_from_start = ros::Duration(sample_num * sample_duration_);
 
-    ROS_INFO_STREAM(
-        "Uniform sampling, resample duraction: " << sample_duration_ << " input traj. size: " << trajectory_in.request.trajectory.points.size() << " output traj. size: " << trajectory_out.request.trajectory.points.size());
+    ROS_DEBUG_STREAM(
+        "Uniform sampling, resample duration: " << sample_duration_ << " input traj. size: " << size_in << " output traj. size: " << points_out.size());
 
-    success = true;
-    return success;
+    return true;
   }
 
-template<typename T>
-  bool UniformSampleFilter<T>::interpolatePt(trajectory_msgs::JointTrajectoryPoint & p1,
-                                             trajectory_msgs::JointTrajectoryPoint & p2, double time_from_start,
-                                             trajectory_msgs::JointTrajectoryPoint & interp_pt)
+void QuinticSegment::fit(const double * pos1, const double * vel1, const double * acc1,
+                         const double * pos2, const double * vel2, const double * acc2, size_t size, double duration)
+{
+  coefficients_.resize(6 * size);
+
+  double t1 = duration;
+  double t2 = t1 * t1, t3 = t2 * t1, t4 = t3 * t1, t5 = t4 * t1;
+
+  for (size_t i = 0; i < size; ++i)
   {
-    bool rtn = false;
-    double p1_time_from_start = p1.time_from_start.toSec();
-    double p2_time_from_start = p2.time_from_start.toSec();
+    double * c = &coefficients_[6 * i];
 
-    ROS_INFO_STREAM("time from start: " << time_from_start);
+    if (t1 <= 0.0)
+    {
+      c[0] = pos2[i];
+      c[1] = c[2] = c[3] = c[4] = c[5] = 0.0;
+      continue;
+    }
+
+    c[0] = pos1[i];
+    c[1] = vel1[i];
+    c[2] = 0.5 * acc1[i];
+    c[3] = (-20.0 * pos1[i] + 20.0 * pos2[i] - 3.0 * acc1[i] * t2 + acc2[i] * t2 - 12.0 * vel1[i] * t1 - 8.0 * vel2[i] * t1) / (2.0 * t3);
+    c[4] = (30.0 * pos1[i] - 30.0 * pos2[i] + 3.0 * acc1[i] * t2 - 2.0 * acc2[i] * t2 + 16.0 * vel1[i] * t1 + 14.0 * vel2[i] * t1) / (2.0 * t4);
+    c[5] = (-12.0 * pos1[i] + 12.0 * pos2[i] - acc1[i] * t2 + acc2[i] * t2 - 6.0 * vel1[i] * t1 - 6.0 * vel2[i] * t1) / (2.0 * t5);
+  }
+}
+
+void QuinticSegment::sample(double time_from_p1, double * pos, double * vel, double * acc) const
+{
+  double t = time_from_p1;
+  size_t size = coefficients_.size() / 6;
 
-    if (time_from_start >= p1_time_from_start && time_from_start <= p2_time_from_start)
+  for (size_t i = 0; i < size; ++i)
+  {
+    const double * c = &coefficients_[6 * i];
+
+    pos[i] = c[0] + t * (c[1] + t * (c[2] + t * (c[3] + t * (c[4] + t * c[5]))));
+    vel[i] = c[1] + t * (2.0 * c[2] + t * (3.0 * c[3] + t * (4.0 * c[4] + t * 5.0 * c[5])));
+    acc[i] = 2.0 * c[2] + t * (6.0 * c[3] + t * (12.0 * c[4] + t * 20.0 * c[5]));
+  }
+}
+
+UniformSampleTrajectoryFilter::UniformSampleTrajectoryFilter() :
+    TrajectoryFilterBase(), sample_duration_(DEFAULT_SAMPLE_DURATION)
+{
+  filter_name_ = "UniformSampleFilter";
+  filter_type_ = "UniformSampleTrajectoryFilter";
+}
+
+bool UniformSampleTrajectoryFilter::configure()
+{
+  if (!nh_.getParam("sample_duration", sample_duration_))
+  {
+    ROS_WARN_STREAM( "UniformSampleFilter, params has no attribute sample_duration.");
+  }
+  ROS_INFO_STREAM("Using a sample_duration value of " << sample_duration_);
+
+  return true;
+}
+
+bool UniformSampleTrajectoryFilter::update(robot_trajectory::RobotTrajectory& trajectory)
+{
+  size_t size_in = trajectory.getWayPointCount();
+
+  if (size_in < 2 || sample_duration_ <= 0.0)
+    return true;
+
+  size_t variable_num = trajectory.getWayPoint(0).getVariableCount();
+  std::vector<double> time_from_start(size_in);
+  double time = 0.0;
+
+  for (size_t index_in = 0; index_in < size_in; ++index_in)
+  {
+    const robot_state::RobotState & state = trajectory.getWayPoint(index_in);
+    if (!state.hasVelocities() || !state.hasAccelerations())
     {
-      if (p1.positions.size() == p1.velocities.size() && p1.positions.size() == p1.accelerations.size())
-      {
-        if (p1.positions.size() == p2.positions.size() && p1.velocities.size() == p2.velocities.size()
-            && p1.accelerations.size() == p2.accelerations.size())
-        {
-          // Copy p1 to ensure the interp_pt has the correct size vectors
-          interp_pt = p1;
-          // TODO: Creating a new spline calculator in this function means that
-          // it may be created multiple times for the same points (assuming the
-          // resample duration is less that the actual duration, which it might
-          // be sometimes)
-          KDL::VelocityProfile_Spline spline_calc;
-          ROS_INFO_STREAM( "---------------Begin interpolating joint point---------------");
-
-          for (size_t i = 0; i < p1.positions.size(); ++i)
-          {
-            // Calculated relative times for spline calculation
-            double time_from_p1 = time_from_start - p1.time_from_start.toSec();
-            double time_from_p1_to_p2 = p2_time_from_start - p1_time_from_start;
-
-            ROS_INFO_STREAM("time from p1: " << time_from_p1);
-            ROS_INFO_STREAM( "time_from_p1_to_p2: " << time_from_p1_to_p2);
-
-            spline_calc.SetProfileDuration(p1.positions[i], p1.velocities[i], p1.accelerations[i], p2.positions[i],
-                                           p2.velocities[i], p2.accelerations[i], time_from_p1_to_p2);
-
-            ros::Duration time_from_start_dur(time_from_start);
-            ROS_INFO_STREAM( "time from start_dur: " << time_from_start_dur);
-
-            interp_pt.time_from_start = time_from_start_dur;
-            interp_pt.positions[i] = spline_calc.Pos(time_from_p1);
-            interp_pt.velocities[i] = spline_calc.Vel(time_from_p1);
-            interp_pt.accelerations[i] = spline_calc.Acc(time_from_p1);
-
-            ROS_INFO_STREAM(
-                "p1.pos: " << p1.positions[i] << ", vel: " << p1.velocities[i] << ", acc: " << p1.accelerations[i] << ", tfs: " << p1.time_from_start);
-
-            ROS_INFO_STREAM(
-                "p2.pos: " << p2.positions[i] << ", vel: " << p2.velocities[i] << ", acc: " << p2.accelerations[i] << ", tfs: " << p2.time_from_start);
-
-            ROS_INFO_STREAM(
-                "interp_pt.pos: " << interp_pt.positions[i] << ", vel: " << interp_pt.velocities[i] << ", acc: " << interp_pt.accelerations[i] << ", tfs: " << interp_pt.time_from_start);
-          }
-          ROS_INFO_STREAM( "---------------End interpolating joint point---------------");
-          rtn = true;
-        }
-        else
-        {
-          ROS_ERROR_STREAM("Trajectory point size mismatch");
-          ROS_ERROR_STREAM(
-              "Trajectory point 1, pos: " << p1.positions.size() << " vel: " << p1.velocities.size() << " acc: " << p1.accelerations.size());
-          ROS_ERROR_STREAM(
-              "Trajectory point 2, pos: " << p2.positions.size() << " vel: " << p2.velocities.size() << " acc: " << p2.accelerations.size());
-          rtn = false;
-        }
+      ROS_ERROR_STREAM("Trajectory waypoint " << index_in << " has no velocities or accelerations");
+      return false;
+    }
 
-      }
-      else
-      {
-        ROS_ERROR_STREAM(
-            "Trajectory point not fully defined, pos: " << p1.positions.size() << " vel: " << p1.velocities.size() << " acc: " << p1.accelerations.size());
-        rtn = false;
-      }
+    time += trajectory.getWayPointDurationFromPrevious(index_in);
+    time_from_start[index_in] = time;
+  }
+
+  double duration_in = time_from_start.back();
+
+  // Samples at 0, dt, ... while before the end, then the last input waypoint (timed at the next sample)
+  size_t sample_num = 0;
+  while (sample_num * sample_duration_ < duration_in)
+    sample_num++;
+
+  robot_trajectory::RobotTrajectory trajectory_out(trajectory.getRobotModel(), trajectory.getGroupName());
+  robot_state::RobotState interp_state(trajectory.getWayPoint(0));
+  sample_position_.resize(variable_num);
+
+  size_t index_in = 0;
+  const robot_state::RobotState * p1 = &trajectory.getWayPoint(0);
+  const robot_state::RobotState * p2 = &trajectory.getWayPoint(1);
+  segment_.fit(p1->getVariablePositions(), p1->getVariableVelocities(), p1->getVariableAccelerations(),
+               p2->getVariablePositions(), p2->getVariableVelocities(), p2->getVariableAccelerations(),
+               variable_num, time_from_start[1] - time_from_start[0]);
+
+  for (size_t index_out = 0; index_out < sample_num; ++index_out)
+  {
+    double interpolated_time = index_out * sample_duration_;
+
+    bool is_moved = false;
+    while (index_in + 2 < size_in && interpolated_time > time_from_start[index_in + 1])
+    {
+      index_in++;
+      is_moved = true;
     }
-    else
+    if (is_moved)
     {
-      ROS_ERROR_STREAM(
-          "Time: " << time_from_start << " not between interpolation point times[" << p1.time_from_start.toSec() << "," << p2.time_from_start.toSec() << "]");
-      rtn = false;
+      p1 = &trajectory.getWayPoint(index_in);
+      p2 = &trajectory.getWayPoint(index_in + 1);
+      segment_.fit(p1->getVariablePositions(), p1->getVariableVelocities(), p1->getVariableAccelerations(),
+                   p2->getVariablePositions(), p2->getVariableVelocities(), p2->getVariableAccelerations(),
+                   variable_num, time_from_start[index_in + 1] - time_from_start[index_in]);
     }
 
-    return rtn;
+    // Velocities and accelerations straight into the state, positions through the setter to dirty the transforms
+    segment_.sample(interpolated_time - time_from_start[index_in],
+                    &sample_position_[0], interp_state.getVariableVelocities(), interp_state.getVariableAccelerations());
+    interp_state.setVariablePositions(sample_position_);
+
+    trajectory_out.addSuffixWayPoint(interp_state, (index_out == 0) ? 0.0 : sample_duration_);
   }
 
+  trajectory_out.addSuffixWayPoint(trajectory.getWayPoint(size_in - 1), sample_duration_);
+
+  ROS_DEBUG_STREAM(
+      "Uniform sampling, resample duration: " << sample_duration_ << " input traj. size: " << size_in << " output traj. size: " << trajectory_out.getWayPointCount());
+
+  trajectory.swap(trajectory_out);
+  return true;
+}
+
 // registering planner adapter
 CLASS_LOADER_REGISTER_CLASS( industrial_trajectory_filters::UniformSampleFilterAdapter,
                             planning_request_adapter::PlanningRequestAdapter);
+CLASS_LOADER_REGISTER_CLASS( industrial_trajectory_filters::UniformSampleTrajectoryFilter,
+                            planning_request_adapter::PlanningRequestAdapter);
 
 /*
  * Old plugin declaration for arm navigation trajectory filters
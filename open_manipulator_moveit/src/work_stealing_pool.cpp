@@ -0,0 +1,127 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <industrial_trajectory_filters/work_stealing_pool.h>
+
+#include <algorithm>
+#include <thread>
+
+using namespace industrial_trajectory_filters;
+
+WorkStealingPool::WorkStealingPool(std::size_t thread_num)
+{
+  if (thread_num == 0)
+    thread_num = std::max(1u, std::thread::hardware_concurrency());
+
+  for (std::size_t worker = 0; worker < thread_num; worker++)
+    queues_.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+}
+
+void WorkStealingPool::run(std::size_t task_num, const Task& task)
+{
+  const std::size_t thread_num = queues_.size();
+
+  // Contiguous blocks, neighbouring trajectories tend to be alike in length
+  for (std::size_t worker = 0; worker < thread_num; worker++)
+  {
+    std::deque<std::size_t> &tasks = queues_[worker]->tasks;
+    tasks.clear();
+
+    for (std::size_t index = worker * task_num / thread_num; index < (worker + 1) * task_num / thread_num; index++)
+      tasks.push_back(index);
+  }
+
+  exception_ = std::exception_ptr();
+
+  // The calling thread is the last worker
+  std::vector<std::thread> threads;
+  for (std::size_t worker = 0; worker + 1 < thread_num; worker++)
+    threads.push_back(std::thread(&WorkStealingPool::work, this, worker, std::cref(task)));
+
+  work(thread_num - 1, task);
+
+  for (std::size_t index = 0; index < threads.size(); index++)
+    threads[index].join();
+
+  if (exception_)
+    std::rethrow_exception(exception_);
+}
+
+void WorkStealingPool::work(std::size_t worker, const Task& task)
+{
+  std::size_t index;
+
+  // Tasks are never added during a run, so empty queues everywhere means done
+  while (popTask(worker, index) || (stealTasks(worker) && popTask(worker, index)))
+  {
+    try
+    {
+      task(index, worker);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(exception_mutex_);
+      if (!exception_)
+        exception_ = std::current_exception();
+    }
+  }
+}
+
+bool WorkStealingPool::popTask(std::size_t worker, std::size_t& index)
+{
+  WorkQueue &queue = *queues_[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+
+  if (queue.tasks.empty())
+    return false;
+
+  index = queue.tasks.front();
+  queue.tasks.pop_front();
+  return true;
+}
+
+bool WorkStealingPool::stealTasks(std::size_t worker)
+{
+  const std::size_t thread_num = queues_.size();
+
+  for (std::size_t offset = 1; offset < thread_num; offset++)
+  {
+    WorkQueue &victim = *queues_[(worker + offset) % thread_num];
+    std::deque<std::size_t> stolen;
+
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+
+      // Half of the rest, rounded up, from the end the owner reaches last
+      const std::size_t steal_num = (victim.tasks.size() + 1) / 2;
+      for (std::size_t count = 0; count < steal_num; count++)
+      {
+        stolen.push_front(victim.tasks.back());
+        victim.tasks.pop_back();
+      }
+    }
+
+    if (stolen.empty())
+      continue;
+
+    WorkQueue &queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.insert(queue.tasks.end(), stolen.begin(), stolen.end());
+    return true;
+  }
+
+  return false;
+}
@@ -20,6 +20,7 @@
 #define OPEN_MANIPULATOR_ARM_CONTROLLER_H
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 
 #include <moveit/move_group_interface/move_group_interface.h>
 #include <moveit/robot_state/robot_state.h>
@@ -31,15 +32,20 @@
 
 #include <moveit_msgs/DisplayTrajectory.h>
 
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <std_msgs/Float64.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <std_msgs/String.h>
 
 #include <sensor_msgs/JointState.h>
 #include <geometry_msgs/PoseStamped.h>
-
-#include "open_manipulator_msgs/State.h"
+#include <geometry_msgs/TwistStamped.h>
+#include <trajectory_msgs/JointTrajectory.h>
 
 #include "open_manipulator_msgs/GetJointPosition.h"
 #include "open_manipulator_msgs/GetKinematicsPose.h"
@@ -49,17 +55,25 @@
 
 #include <eigen3/Eigen/Eigen>
 
+#include "open_manipulator_position_ctrl/chain_kinematics.h"
+#include "open_manipulator_position_ctrl/chain_servo.h"
+#include "open_manipulator_position_ctrl/online_trajectory_generator.h"
+#include "open_manipulator_position_ctrl/planned_path_info.h"
+#include "open_manipulator_position_ctrl/streaming_smoothing_filter.h"
+#include "open_manipulator_position_ctrl/trajectory_buffer.h"
+#include "open_manipulator_position_ctrl/TrackingStats.h"
+
 namespace open_manipulator
 {
-#define ITERATION_FREQUENCY 100 //Hz
 #define JOINT_NUM 4
 
-typedef struct
+enum PathResult
 {
-  uint8_t group;
-  uint16_t waypoints;                                  // planned number of via-points
-  Eigen::MatrixXd planned_path_positions;              // planned position trajectory
-} PlannedPathInfo;
+  PATH_NONE,          // no planned path played yet
+  PATH_PLAYING,
+  PATH_COMPLETED,
+  PATH_ABORTED        // stopped by the tracking error
+};
 
 class ArmController
 {
@@ -70,39 +84,134 @@ class ArmController
 
   // ROS Parameters
   bool using_gazebo_;
+  bool using_gazebo_group_command_;   // one group command, or one Float64 per jointN_position controller
   std::string robot_name_;
   int joint_num_;
-  bool init_position_;
+  double control_rate_;
+  double servo_timeout_;
+  int path_capacity_;
 
   // ROS Publisher
-  ros::Publisher gazebo_goal_joint_position_pub_[10];
+  ros::Publisher gazebo_goal_joint_position_pub_;
+  std_msgs::Float64MultiArray gazebo_goal_joint_position_;   // one group command for all joints
+  ros::Publisher gazebo_joint_position_pub_[JOINT_NUM];
+  std_msgs::Float64 gazebo_joint_position_;
   ros::Publisher goal_joint_position_pub_;
-  ros::Publisher arm_state_pub_;
+  sensor_msgs::JointState goal_joint_position_;     // sized once, updated in place every cycle
+  ros::Publisher tracking_stats_pub_;
 
   // ROS Subscribers
-  ros::Subscriber display_planned_path_sub_;
+  ros::Subscriber joint_states_sub_;
+  ros::Subscriber servo_twist_sub_;
+  ros::Subscriber servo_joint_velocity_sub_;
+  ros::Subscriber speed_override_sub_;
 
   // ROS Service Server
   ros::ServiceServer get_joint_position_server_;
   ros::ServiceServer get_kinematics_pose_server_;
   ros::ServiceServer set_joint_position_server_;
   ros::ServiceServer set_kinematics_pose_server_;
+  ros::ServiceServer set_joint_position_online_server_;
 
   // ROS Service Client
 
-  // MoveIt! interface
+  // MoveIt! interface, constructed in the background once move_group is up
   moveit::planning_interface::MoveGroupInterface *move_group;
-  PlannedPathInfo planned_path_info_;
+  std::thread move_group_thread_;
+  std::atomic<bool> is_move_group_ready_;
+  std::mutex move_group_mutex_;
+
+  // Planning services run on their own thread, the control loop keeps playing while they plan
+  ros::NodeHandle planning_nh_;
+  ros::CallbackQueue planning_queue_;
+  ros::AsyncSpinner *planning_spinner_;
+  ros::WallTimer init_position_timer_;
+  TrajectoryBuffer planned_path_;
+
+  // Local forward kinematics on the cached joint states
+  ChainKinematics chain_kinematics_;
+  std::string kinematics_base_frame_;
+  std::string kinematics_tip_link_;
+  std::vector<int> joint_states_index_;                // chain joint -> index in joint_states, -1 if missing
+  std::vector<double> present_joint_position_;         // chain order
+  ros::Time joint_states_stamp_;
+  bool is_joint_states_received_;
+  std::mutex joint_states_mutex_;                      // written on the control thread, read by the services
+  std::vector<double> joint_lower_limit_;
+  std::vector<double> joint_upper_limit_;
+
+  // Servo mode
+  ChainServo chain_servo_;
+  std::atomic<bool> is_servoing_;
+  bool is_twist_command_;
+  Eigen::Matrix<double, 6, 1> servo_twist_;
+  std::vector<double> servo_joint_velocity_;
+  std::vector<double> servo_joint_position_;      // streamed setpoint, chain order
+  ros::Time servo_command_time_;
+  StreamingSmoothingFilter servo_filter_;
+  std::vector<double> servo_filtered_position_;   // published setpoint, chain order
+
+  // Online trajectory (point to point without the planner)
+  OnlineTrajectoryGenerator online_trajectory_;
+  std::atomic<bool> is_online_moving_;
+
+  // Pick and place tasks drive the arm directly, move_group echoes and planning requests are ignored meanwhile
+  std::atomic<bool> is_task_mode_;
+
+  // Speed override of the planned path playback (1.0 = as planned), the applied scale is ramped
+  // towards the commanded one within the joint acceleration limits
+  double speed_override_;
+  double speed_scale_;
+  double speed_override_max_rate_;
+  double speed_override_min_rate_;
+  std::vector<double> joint_max_acceleration_;
+
+  // Closed loop playback: the command leads the reference by the feedforward terms, the present joint
+  // states are compared with the reference to slow down or abort
+  double velocity_feedforward_;        // sec
+  double acceleration_feedforward_;    // sec^2
+  double tracking_slow_down_error_;    // rad
+  double tracking_slow_down_scale_;
+  double tracking_abort_error_;        // rad
+  double tracking_timeout_;            // sec, joint states older than this are not compared
+  bool is_tracking_slowed_;
+  uint32_t tracking_sample_num_;
+  open_manipulator_position_ctrl::TrackingStats tracking_stats_;   // sized once, reused every path
+
+  // Preemption: a new goal is planned from the path state a horizon ahead and blended in there
+  double preempt_horizon_;
+  double preempt_blend_time_;
+  double preempt_velocity_tolerance_;   // rad/s, the new path has to leave the splice waypoint at the path velocity
+  bool is_preempt_planning_;            // display_planned_path echoes of preempting plans are not played,
+  std::deque<trajectory_msgs::JointTrajectory> preempt_echoes_;   // spliced or rejected, whatever the arm does
 
   // Process state variables
-  bool     is_moving_;
-  uint16_t all_time_steps_;
+  std::atomic<bool> is_moving_;
+  PathResult path_result_;      // of the last planned path
+  uint32_t all_time_steps_;     // up to path_capacity
+  double   path_time_;          // nominal time along the planned path, waypoints are 1 / ITERATION_FREQUENCY apart
+  std::mutex path_mutex_;       // planned path and playback state, shared with the planning thread
 
  public:
   ArmController();
   virtual ~ArmController();
 
   void process(void);
+  bool isMoving(void) { return is_moving_ || is_online_moving_ || is_servoing_; }
+  bool isMoveGroupReady(void) { return is_move_group_ready_; }
+  PathResult getPathResult(void);
+  ros::CallbackQueue *getPlanningQueue(void) { return &planning_queue_; }
+
+  void initJointPosition();
+
+  // Plans of the arm group are played back, others are ignored
+  void displayPlannedPathMsgCallback(const moveit_msgs::DisplayTrajectory::ConstPtr &msg);
+
+  // Plan to a pose from the given arm positions (current state if empty), may run outside the control thread
+  bool planPath(const geometry_msgs::Pose &target_pose, const std::vector<double> &start_position,
+                double velocity_scale, double acceleration_scale, trajectory_msgs::JointTrajectory &trajectory);
+  bool startPath(const trajectory_msgs::JointTrajectory &trajectory);
+  void setTaskMode(bool is_task_mode) { is_task_mode_ = is_task_mode; }
 
  private:
   void initPublisher(bool using_gazebo);
@@ -110,12 +219,37 @@ class ArmController
 
   void initServer();
 
-  void initJointPosition();
+  bool initKinematics();
+  void initMoveGroup();
+  void initServo();
+  void initOnlineTrajectory();
+
+  void publishGoalJointPosition(const double *position);
+
+  void processPlannedPath(void);
+  void updateSpeedScale(uint32_t waypoint);
+  void updatePathVelocity(uint32_t first_waypoint, uint32_t last_waypoint);
+  bool updateTrackingError(const double *reference_position);
+  void resetTrackingStats(void);
+  void publishTrackingStats(const std::string &result);
+  void processServo(void);
+  void processOnlineTrajectory(void);
+  bool startServo(void);
 
   bool calcPlannedPath(open_manipulator_msgs::JointPosition msg);
   bool calcPlannedPath(open_manipulator_msgs::KinematicsPose msg);
-
-  void displayPlannedPathMsgCallback(const moveit_msgs::DisplayTrajectory::ConstPtr &msg);
+  bool planPreemptive(const char *goal_type);
+  void setStartPosition(const std::vector<double> &start_position,
+                        const std::vector<double> &start_velocity = std::vector<double>());
+  bool loadPlannedPath(const trajectory_msgs::JointTrajectory &trajectory);
+  bool isPreemptEcho(const trajectory_msgs::JointTrajectory &trajectory);
+  bool splicePlannedPath(const trajectory_msgs::JointTrajectory &trajectory, int splice_waypoint);
+  void initJointPositionTimerCallback(const ros::WallTimerEvent &event);
+
+  void jointStatesMsgCallback(const sensor_msgs::JointState::ConstPtr &msg);
+  void servoTwistMsgCallback(const geometry_msgs::TwistStamped::ConstPtr &msg);
+  void servoJointVelocityMsgCallback(const sensor_msgs::JointState::ConstPtr &msg);
+  void speedOverrideMsgCallback(const std_msgs::Float64::ConstPtr &msg);
 
   bool setJointPositionMsgCallback(open_manipulator_msgs::SetJointPosition::Request &req,
                                    open_manipulator_msgs::SetJointPosition::Response &res);
@@ -128,6 +262,9 @@ class ArmController
 
   bool getKinematicsPoseMsgCallback(open_manipulator_msgs::GetKinematicsPose::Request &req,
                                     open_manipulator_msgs::GetKinematicsPose::Response &res);
+
+  bool setJointPositionOnlineMsgCallback(open_manipulator_msgs::SetJointPosition::Request &req,
+                                         open_manipulator_msgs::SetJointPosition::Response &res);
 };
 }
 
@@ -0,0 +1,74 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_CHAIN_KINEMATICS_H
+#define OPEN_MANIPULATOR_CHAIN_KINEMATICS_H
+
+#include <eigen3/Eigen/Eigen>
+
+#include <vector>
+#include <string>
+
+namespace open_manipulator
+{
+enum ChainJointType
+{
+  CHAIN_JOINT_FIXED = 0,
+  CHAIN_JOINT_REVOLUTE,
+  CHAIN_JOINT_PRISMATIC
+};
+
+typedef struct
+{
+  Eigen::Affine3d origin;     // parent frame -> joint frame, with fixed joints before it folded in
+  Eigen::Vector3d axis;       // unit axis in the joint frame
+  ChainJointType  type;
+} ChainSegment;
+
+/**
+ * @brief Forward kinematics of a serial chain, flattened once from the robot description.
+ *
+ * Joints are added from the base towards the tip. Fixed joints are folded into
+ * the origin of the next movable joint (or into the tip offset), so computing a
+ * pose is one rotation or translation plus one rigid transform per movable joint.
+ */
+class ChainKinematics
+{
+ private:
+  std::vector<ChainSegment> segments_;
+  std::vector<std::string>  joint_names_;
+  Eigen::Affine3d           pending_origin_;   // fixed transforms since the last movable joint
+
+ public:
+  ChainKinematics();
+
+  void clear();
+
+  void addJoint(const std::string &name, const Eigen::Affine3d &origin,
+                const Eigen::Vector3d &axis, ChainJointType type);
+
+  // Movable joints in chain order; positions passed to computePose() follow this order
+  const std::vector<std::string> &getJointNames() const { return joint_names_; }
+  std::size_t getJointNum() const { return segments_.size(); }
+
+  void computePose(const double *position, Eigen::Affine3d &tip_pose) const;
+
+  // Geometric Jacobian of the tip in the base frame, rows [linear; angular], one column per movable joint
+  void computeJacobian(const double *position, Eigen::MatrixXd &jacobian) const;
+};
+}
+
+#endif /*OPEN_MANIPULATOR_CHAIN_KINEMATICS_H*/
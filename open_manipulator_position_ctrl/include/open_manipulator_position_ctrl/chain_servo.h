@@ -0,0 +1,89 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_CHAIN_SERVO_H
+#define OPEN_MANIPULATOR_CHAIN_SERVO_H
+
+#include <eigen3/Eigen/Eigen>
+
+#include <vector>
+
+#include "open_manipulator_position_ctrl/chain_kinematics.h"
+
+namespace open_manipulator
+{
+typedef struct
+{
+  double max_joint_velocity;        // rad/s (m/s for prismatic joints), applied to every joint
+  double joint_limit_margin;        // distance kept from the position limits
+  double damping;                   // damping at the singularity (weighted Jacobian units)
+  double singularity_soft;          // smallest singular value where damping and slow down start
+  double singularity_hard;          // smallest singular value that may not be crossed
+  double angular_weight;            // weight of the angular twist rows against the linear ones (m/rad)
+} ServoParam;
+
+typedef enum
+{
+  SERVO_OK = 0,
+  SERVO_SCALED,                     // command slowed down by a velocity or singularity limit
+  SERVO_JOINT_LIMITED,              // at least one joint stopped at its position limit
+  SERVO_SINGULAR                    // command rejected, it moves further into a singularity
+} ServoStatus;
+
+/**
+ * @brief Converts joint velocity or tip twist commands into joint position increments.
+ *
+ * Twists are mapped with a damped least squares inverse of the tip Jacobian.
+ * The damping grows as the smallest singular value drops below singularity_soft,
+ * and commands that would push it below singularity_hard are rejected. Every
+ * step is scaled to the velocity limit and stopped at the joint position limits.
+ */
+class ChainServo
+{
+ private:
+  const ChainKinematics *kinematics_;
+  ServoParam param_;
+
+  std::vector<double> lower_limit_;
+  std::vector<double> upper_limit_;
+
+  Eigen::MatrixXd jacobian_;
+  Eigen::VectorXd joint_velocity_;
+  std::vector<double> next_position_;
+
+ public:
+  ChainServo();
+
+  void init(const ChainKinematics *kinematics, const ServoParam &param,
+            const std::vector<double> &lower_limit, const std::vector<double> &upper_limit);
+
+  /**
+   * @brief Advance position by one cycle of the given tip twist (base frame, [linear; angular])
+   */
+  ServoStatus stepTwist(const Eigen::Matrix<double, 6, 1> &twist, double period, std::vector<double> &position);
+
+  /**
+   * @brief Advance position by one cycle of the given joint velocities (chain order)
+   */
+  ServoStatus stepJointVelocity(const std::vector<double> &velocity, double period, std::vector<double> &position);
+
+ private:
+  double smallestSingularValue(const double *position);
+  ServoStatus applyLimits(double period, std::vector<double> &position);
+};
+}
+
+#endif /*OPEN_MANIPULATOR_CHAIN_SERVO_H*/
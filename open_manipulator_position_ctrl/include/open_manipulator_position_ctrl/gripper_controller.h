@@ -20,6 +20,7 @@
 #define OPEN_MANIPULATOR_GRIPPER_CONTROLLER_H
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 
 #include <moveit/move_group_interface/move_group_interface.h>
 #include <moveit/robot_state/robot_state.h>
@@ -27,35 +28,34 @@
 
 #include <moveit_msgs/DisplayTrajectory.h>
 
+#include <atomic>
+#include <thread>
 #include <vector>
 
 #include <std_msgs/Float64.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <std_msgs/String.h>
 
 #include <sensor_msgs/JointState.h>
 
 #include "open_manipulator_msgs/SetJointPosition.h"
-#include "open_manipulator_msgs/State.h"
+#include "open_manipulator_position_ctrl/GraspState.h"
 
 #include <eigen3/Eigen/Eigen>
 
+#include "open_manipulator_position_ctrl/online_trajectory_generator.h"
+#include "open_manipulator_position_ctrl/planned_path_info.h"
+#include "open_manipulator_position_ctrl/trajectory_buffer.h"
+
 namespace open_manipulator
 {
 #define LEFT_PALM   0
 #define RIGHT_PALM  1
 
-#define ITERATION_FREQUENCY 100 //Hz
-
 #define GRIP_ON   -0.008    // mm
 #define GRIP_OFF  0.008
 #define NEUTRAL   0.0
 
-typedef struct
-{
-  uint16_t waypoints;                                  // planned number of via-points
-  Eigen::MatrixXd planned_path_positions;              // planned position trajectory
-} PlannedPathInfo;
-
 class GripperController
 {
  private:
@@ -65,51 +65,117 @@ class GripperController
 
   // ROS Parameters
   bool using_gazebo_;
+  bool using_gazebo_group_command_;   // one group command, or one Float64 per palm position controller
   std::string robot_name_;
+  double control_rate_;
   int palm_num_;
   int gripper_dxl_id_;
 
   // ROS Publisher
-  ros::Publisher gazebo_gripper_position_pub_[2];
+  ros::Publisher gazebo_gripper_position_pub_;
+  std_msgs::Float64MultiArray gazebo_goal_gripper_position_;   // one group command for both palms
+  ros::Publisher gazebo_palm_position_pub_[2];
+  std_msgs::Float64 gazebo_palm_position_;
   ros::Publisher gripper_position_pub_;
-  ros::Publisher gripper_state_pub_;
+  sensor_msgs::JointState goal_gripper_position_;   // sized once, updated in place every cycle
+  ros::Publisher grasp_state_pub_;
 
   // ROS Subscribers
-  ros::Subscriber display_planned_path_sub_;
   ros::Subscriber gripper_onoff_sub_;
+  ros::Subscriber joint_states_sub_;
 
   // ROS Service Server
   ros::ServiceServer set_gripper_position_server_;
+  ros::ServiceServer set_gripper_position_online_server_;
 
   // ROS Service Client
 
-  // MoveIt! interface
+  // MoveIt! interface, constructed in the background once move_group is up
   moveit::planning_interface::MoveGroupInterface *move_group;
-  PlannedPathInfo planned_path_info_;
+  std::thread move_group_thread_;
+  std::atomic<bool> is_move_group_ready_;
+
+  // Planning services run on the planning thread of the arm, the control loop keeps playing while they plan
+  ros::NodeHandle planning_nh_;
+  TrajectoryBuffer planned_path_;
+
+  // Online trajectory (point to point without the planner)
+  std::vector<std::string> gripper_joint_names_;
+  std::vector<double> gripper_lower_limit_;
+  std::vector<double> gripper_upper_limit_;
+  std::vector<double> present_gripper_position_;
+  bool is_joint_states_received_;
+  OnlineTrajectoryGenerator online_trajectory_;
+  std::atomic<bool> is_online_moving_;
+
+  // Goal current sent along with the goal position (driver current_mode, raw value, 0 = keep)
+  double grip_current_;
+  double release_current_;
+  double goal_current_;
+
+  // Grasp detection while closing with grip_on: current above the threshold and no motion for the stall time
+  double grasp_current_threshold_;
+  double grasp_stall_velocity_;
+  double grasp_stall_time_;
+  double grasp_settle_time_;
+  double present_gripper_current_;
+  double present_gripper_velocity_;
+  ros::Time joint_states_stamp_;
+  bool is_grasping_;
+  ros::Time grasp_start_time_;
+  ros::Time grasp_stall_start_time_;
+  ros::Time grasp_motion_end_time_;
+  std::string grasp_result_;
 
   // Process state variables
-  bool     is_moving_;
+  std::atomic<bool> is_moving_;
   uint16_t all_time_steps_;
+  uint16_t step_cnt_;
+  double   path_step_time_;
 
  public:
-  GripperController();
+  GripperController(ros::CallbackQueue *planning_queue);
   virtual ~GripperController();
 
   void process(void);
+  bool isMoving(void) { return is_moving_ || is_online_moving_; }
+  bool isMoveGroupReady(void) { return is_move_group_ready_; }
+
+  // Local motions, streamed from the next control cycle on
+  bool moveGripper(double position) { return startOnlineTrajectory(position, 1.0, 1.0, release_current_); }
+  bool startGrasp(void);
+  bool isGrasping(void) { return is_grasping_; }
+  const std::string &getGraspResult(void) { return grasp_result_; }
+
+  // Plans of the gripper group are played back, others are ignored
+  void displayPlannedPathMsgCallback(const moveit_msgs::DisplayTrajectory::ConstPtr &msg);
 
  private:
   void initPublisher(bool using_gazebo);
   void initSubscriber(bool using_gazebo);
 
   void initServer();
+  void initOnlineTrajectory();
+  void initMoveGroup();
 
   bool calcPlannedPath(open_manipulator_msgs::JointPosition msg);
+  bool startOnlineTrajectory(double position, double velocity_scale, double acceleration_scale, double goal_current);
 
-  void displayPlannedPathMsgCallback(const moveit_msgs::DisplayTrajectory::ConstPtr &msg);
+  void jointStatesMsgCallback(const sensor_msgs::JointState::ConstPtr &msg);
 
   bool setGripperPositionMsgCallback(open_manipulator_msgs::SetJointPosition::Request &req,
                                      open_manipulator_msgs::SetJointPosition::Response &res);
 
+  bool setGripperPositionOnlineMsgCallback(open_manipulator_msgs::SetJointPosition::Request &req,
+                                           open_manipulator_msgs::SetJointPosition::Response &res);
+
+  void publishGoalGripperPosition(double left_position, double right_position);
+
+  void processPlannedPath(void);
+  void processOnlineTrajectory(void);
+  void processGraspDetection(void);
+  void publishGraspState(const std::string &result);
+
   void gripperOnOffMsgCallback(const std_msgs::String::ConstPtr &msg);
 };
 }
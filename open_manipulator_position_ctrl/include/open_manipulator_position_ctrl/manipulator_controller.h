@@ -0,0 +1,151 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_MANIPULATOR_CONTROLLER_H
+#define OPEN_MANIPULATOR_MANIPULATOR_CONTROLLER_H
+
+#include <ros/ros.h>
+
+#include <moveit_msgs/DisplayTrajectory.h>
+#include <sensor_msgs/JointState.h>
+#include <trajectory_msgs/JointTrajectory.h>
+
+#include <future>
+
+#include "open_manipulator_msgs/State.h"
+#include "open_manipulator_position_ctrl/ManipulatorState.h"
+#include "open_manipulator_position_ctrl/PickPlace.h"
+
+#include "open_manipulator_position_ctrl/arm_controller.h"
+#include "open_manipulator_position_ctrl/gripper_controller.h"
+
+namespace open_manipulator
+{
+enum TaskPhase
+{
+  TASK_IDLE,
+  TASK_PLANNING,    // arm paths are planned while the gripper pre-shapes
+  TASK_APPROACH,
+  TASK_DESCEND,     // starts once the approach is reached and the gripper is pre-shaped
+  TASK_GRASP,       // retreat starts as soon as the grasp is detected
+  TASK_RELEASE,
+  TASK_RETREAT
+};
+
+enum TaskPath
+{
+  APPROACH_PATH,
+  GRASP_PATH,
+  RETREAT_PATH,
+  TASK_PATH_NUM
+};
+
+/**
+ * @brief Arm and gripper controllers in one process.
+ *
+ * Both MoveGroupInterfaces share the robot model and the current state monitor
+ * of the process, both groups are driven from the same control cycle and one
+ * subscription dispatches the planned paths. The combined state is published
+ * every cycle, arm_state and gripper_state only when they change.
+ *
+ * Startup waits only for what is needed: the robot description before the
+ * controllers are built, then the first joint_states and move_group are tracked
+ * from the control loop while the services are already up.
+ *
+ * Pick and place tasks run as one timeline on both controllers: all three arm
+ * paths are planned in the background while the gripper pre-shapes, and each
+ * phase starts on the cycle its preconditions are met.
+ */
+class ManipulatorController
+{
+ private:
+  // ROS NodeHandle
+  ros::NodeHandle nh_;
+  ros::NodeHandle priv_nh_;
+
+  // ROS Parameters
+  std::string robot_name_;
+  double control_rate_;
+  bool init_position_;
+  double startup_timeout_;
+
+  // ROS Publisher
+  ros::Publisher manipulator_state_pub_;
+  ros::Publisher arm_state_pub_;
+  ros::Publisher gripper_state_pub_;
+
+  // ROS Subscribers
+  ros::Subscriber display_planned_path_sub_;
+  ros::Subscriber joint_states_sub_;
+
+  // ROS Service Server
+  ros::ServiceServer pick_place_server_;
+
+  // Controllers
+  ArmController *arm_controller_;
+  GripperController *gripper_controller_;
+
+  // Startup, times are measured from the construction of the node (sec, negative until ready)
+  ros::WallTime startup_time_;
+  double robot_description_time_;
+  double joint_states_time_;
+  double move_group_time_;
+  bool is_ready_;
+  bool is_startup_timed_out_;
+
+  // Pick and place task
+  TaskPhase task_phase_;
+  open_manipulator_position_ctrl::PickPlace::Request task_;
+  std::future<bool> task_plan_;
+  trajectory_msgs::JointTrajectory task_path_[TASK_PATH_NUM];
+  ros::WallTime task_start_time_;
+
+  // Process state variables
+  open_manipulator_position_ctrl::ManipulatorState manipulator_state_;
+
+ public:
+  ManipulatorController();
+  virtual ~ManipulatorController();
+
+  bool init(void);
+  void process(void);
+
+  double getControlRate() { return control_rate_; }
+
+ private:
+  void initPublisher();
+  void initSubscriber();
+  void initServer();
+
+  bool waitForRobotDescription(void);
+  void checkReadiness(void);
+
+  void publishState(bool is_arm_moving, bool is_gripper_moving);
+
+  bool planTask(void);
+  void processTask(void);
+  void setTaskPhase(TaskPhase phase);
+  void finishTask(const std::string &result);
+
+  void displayPlannedPathMsgCallback(const moveit_msgs::DisplayTrajectory::ConstPtr &msg);
+  void jointStatesMsgCallback(const sensor_msgs::JointState::ConstPtr &msg);
+
+  bool pickPlaceMsgCallback(open_manipulator_position_ctrl::PickPlace::Request &req,
+                            open_manipulator_position_ctrl::PickPlace::Response &res);
+};
+}
+
+#endif /*OPEN_MANIPULATOR_MANIPULATOR_CONTROLLER_H*/
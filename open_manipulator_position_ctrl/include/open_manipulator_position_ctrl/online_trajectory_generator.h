@@ -0,0 +1,96 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_ONLINE_TRAJECTORY_GENERATOR_H
+#define OPEN_MANIPULATOR_ONLINE_TRAJECTORY_GENERATOR_H
+
+#include <vector>
+
+namespace open_manipulator
+{
+typedef struct
+{
+  double max_velocity;
+  double max_acceleration;
+  double max_jerk;
+} MotionLimit;
+
+typedef struct
+{
+  double position;
+  double velocity;
+  double acceleration;
+} MotionState;
+
+/**
+ * @brief Jerk-limited point-to-point motion computed one control cycle at a time.
+ *
+ * Every update() picks, for each joint, the largest jerk that still lets the
+ * joint brake to rest on the target without exceeding its velocity and
+ * acceleration limits, and integrates it over one period. Since nothing but the
+ * present position, velocity and acceleration is kept, the target may be
+ * changed at any cycle and the motion stays continuous in acceleration.
+ *
+ * setTarget() synchronizes the joints: the limits of every joint are scaled in
+ * time so that its rest-to-rest duration matches the slowest joint.
+ */
+class OnlineTrajectoryGenerator
+{
+ private:
+  double period_;
+
+  std::vector<MotionLimit> limit_;
+  std::vector<MotionLimit> sync_limit_;     // limit_ scaled by the request and by time synchronization
+  std::vector<MotionState> state_;
+  std::vector<double> target_;
+
+  double duration_;                         // synchronized rest-to-rest duration of the last target
+  bool is_finished_;
+
+ public:
+  OnlineTrajectoryGenerator();
+
+  void init(const std::vector<MotionLimit> &limit, double period);
+
+  // Start at rest at the given position
+  void reset(const std::vector<double> &position);
+
+  /**
+   * @brief Move towards a new target from the present state
+   * @param velocity_scale, acceleration_scale fraction of the limits used (0 ~ 1]
+   */
+  void setTarget(const std::vector<double> &target, double velocity_scale = 1.0, double acceleration_scale = 1.0);
+
+  /**
+   * @brief Advance one period
+   * @return true while moving, false once every joint rests on its target
+   */
+  bool update();
+
+  const std::vector<MotionState> &getState() const { return state_; }
+  const std::vector<double> &getTarget() const { return target_; }
+  double getDuration() const { return duration_; }
+  bool isFinished() const { return is_finished_; }
+
+  // Rest-to-rest duration of a move of the given distance under the given limits
+  static double calcDuration(double distance, const MotionLimit &limit);
+
+ private:
+  double calcJerk(const MotionState &state, double target, const MotionLimit &limit) const;
+};
+}
+
+#endif /*OPEN_MANIPULATOR_ONLINE_TRAJECTORY_GENERATOR_H*/
@@ -0,0 +1,26 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_PLANNED_PATH_INFO_H
+#define OPEN_MANIPULATOR_PLANNED_PATH_INFO_H
+
+namespace open_manipulator
+{
+#define ITERATION_FREQUENCY 100 //Hz, planned path playback
+#define CONTROL_FREQUENCY   200 //Hz, default control loop
+}
+
+#endif /*OPEN_MANIPULATOR_PLANNED_PATH_INFO_H*/
@@ -0,0 +1,96 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_STREAMING_SMOOTHING_FILTER_H
+#define OPEN_MANIPULATOR_STREAMING_SMOOTHING_FILTER_H
+
+#include <string>
+#include <vector>
+
+namespace open_manipulator
+{
+typedef enum
+{
+  SMOOTHING_NONE = 0,
+  SMOOTHING_FIR,                    // causal FIR on the last coefficients.size() samples
+  SMOOTHING_LOW_PASS                // second order Butterworth low pass
+} SmoothingType;
+
+typedef struct
+{
+  SmoothingType type;
+  std::vector<double> coefficients; // FIR, newest sample first, normalized to unity gain
+  double cutoff_frequency;          // Hz, low pass
+} SmoothingParam;
+
+/**
+ * @brief Causal smoothing of a stream of joint setpoints, one sample per control cycle.
+ *
+ * Unlike SmoothingTrajectoryFilter of open_manipulator_moveit it never looks ahead: every
+ * update() takes the newest setpoint of each joint and returns the filtered one. The state
+ * (FIR history or biquad memory) is allocated by init() for a fixed number of joints, so
+ * update() does a constant amount of work and no allocation.
+ *
+ * The smoothing costs latency, getGroupDelay() reports it for slow motion (at DC): a ramp
+ * of the input is followed by the output that many seconds later.
+ */
+class StreamingSmoothingFilter
+{
+ private:
+  SmoothingType type_;
+  std::size_t joint_num_;
+  double period_;
+
+  // FIR, ring buffer of the last num_coef_ samples of every joint (sample major)
+  std::vector<double> coefficients_;
+  std::vector<double> history_;
+  std::size_t num_coef_;
+  std::size_t newest_;
+
+  // Low pass, transposed direct form II
+  double b0_, b1_, b2_, a1_, a2_;
+  std::vector<double> state1_;
+  std::vector<double> state2_;
+
+  double group_delay_;              // sec
+
+ public:
+  StreamingSmoothingFilter();
+
+  /**
+   * @brief Allocate the state for joint_num joints sampled every period
+   * @return false if the parameters do not describe a stable unity gain filter
+   */
+  bool init(const SmoothingParam &param, std::size_t joint_num, double period);
+
+  // Start at rest at the given position, as if it had been held forever
+  void reset(const double *position);
+
+  /**
+   * @brief Filter one sample of every joint, input and output may be the same array
+   */
+  void update(const double *input, double *output);
+
+  double getGroupDelay() const { return group_delay_; }
+
+  /**
+   * @brief Parse a type name: none, fir or low_pass
+   */
+  static bool getType(const std::string &name, SmoothingType &type);
+};
+}
+
+#endif /*OPEN_MANIPULATOR_STREAMING_SMOOTHING_FILTER_H*/
@@ -0,0 +1,71 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef OPEN_MANIPULATOR_TRAJECTORY_BUFFER_H
+#define OPEN_MANIPULATOR_TRAJECTORY_BUFFER_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace open_manipulator
+{
+/**
+ * @brief Fixed-capacity trajectory storage for playback.
+ *
+ * Memory is allocated once by init(); waypoints are stored contiguously as
+ * [positions, velocities, time] so a playback step reads one cache line run.
+ * Nothing allocates after init(), waypoints beyond the capacity are refused.
+ */
+class TrajectoryBuffer
+{
+ private:
+  uint8_t  joint_num_;
+  uint32_t stride_;
+  uint32_t capacity_;
+  uint32_t size_;
+
+  std::vector<double> data_;
+
+ public:
+  TrajectoryBuffer();
+
+  void init(uint8_t joint_num, uint32_t capacity);
+  void clear() { size_ = 0; }
+
+  /**
+   * @brief Append a waypoint
+   * @param velocity may be NULL, zero velocity is stored then
+   * @return false if the buffer is full
+   */
+  bool push(const double *position, const double *velocity, double time);
+
+  // Change the number of waypoints within the capacity, new waypoints are left as they are for in-place edits
+  bool resize(uint32_t size);
+
+  uint8_t  getJointNum() const { return joint_num_; }
+  uint32_t getSize() const { return size_; }
+  uint32_t getCapacity() const { return capacity_; }
+
+  const double *getPosition(uint32_t index) const { return &data_[index * stride_]; }
+  double       *getPosition(uint32_t index)       { return &data_[index * stride_]; }
+  const double *getVelocity(uint32_t index) const { return &data_[index * stride_ + joint_num_]; }
+  double       *getVelocity(uint32_t index)       { return &data_[index * stride_ + joint_num_]; }
+  double        getTime(uint32_t index) const     { return data_[index * stride_ + 2 * joint_num_]; }
+  void          setTime(uint32_t index, double time) { data_[index * stride_ + 2 * joint_num_] = time; }
+};
+}
+
+#endif /*OPEN_MANIPULATOR_TRAJECTORY_BUFFER_H*/
@@ -18,44 +18,152 @@
 
 #include "open_manipulator_position_ctrl/arm_controller.h"
 
+#include <urdf/model.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
 using namespace open_manipulator;
 
+static const double SERVO_SETTLE_TOLERANCE = 1e-5;   // rad, smoothed setpoint to the last command
+static const std::size_t PREEMPT_ECHO_NUM = 4;       // echoes of preempting plans waited for
+
 ArmController::ArmController()
     :priv_nh_("~"),
      using_gazebo_(false),
+     using_gazebo_group_command_(false),
      robot_name_(""),
-     init_position_(false),
      joint_num_(4),
-     is_moving_(false)
+     is_moving_(false),
+     path_result_(PATH_NONE),
+     all_time_steps_(0),
+     kinematics_tip_link_("link5"),
+     is_joint_states_received_(false),
+     control_rate_(CONTROL_FREQUENCY),
+     servo_timeout_(0.1),
+     path_capacity_(6000),
+     is_servoing_(false),
+     is_twist_command_(false),
+     speed_override_(1.0),
+     speed_scale_(1.0),
+     speed_override_max_rate_(2.0),
+     speed_override_min_rate_(0.2),
+     path_time_(0.0),
+     is_online_moving_(false),
+     move_group(NULL),
+     is_move_group_ready_(false),
+     planning_spinner_(NULL),
+     is_task_mode_(false),
+     velocity_feedforward_(0.03),
+     acceleration_feedforward_(0.0),
+     tracking_slow_down_error_(0.1),
+     tracking_slow_down_scale_(0.5),
+     tracking_abort_error_(0.3),
+     tracking_timeout_(0.1),
+     is_tracking_slowed_(false),
+     tracking_sample_num_(0),
+     preempt_horizon_(0.15),
+     preempt_blend_time_(0.2),
+     preempt_velocity_tolerance_(0.02),
+     is_preempt_planning_(false)
 {
   // Init parameter
   nh_.getParam("gazebo", using_gazebo_);
+  nh_.getParam("gazebo_group_command", using_gazebo_group_command_);
   nh_.getParam("robot_name", robot_name_);
-  priv_nh_.getParam("init_position", init_position_);
+  priv_nh_.getParam("kinematics_tip_link", kinematics_tip_link_);
+  priv_nh_.getParam("control_rate", control_rate_);
+  priv_nh_.getParam("servo_timeout", servo_timeout_);
+  priv_nh_.getParam("path_capacity", path_capacity_);
+  priv_nh_.getParam("speed_override/max_rate", speed_override_max_rate_);
+  priv_nh_.getParam("speed_override/min_rate", speed_override_min_rate_);
+  priv_nh_.getParam("tracking/velocity_feedforward", velocity_feedforward_);
+  priv_nh_.getParam("tracking/acceleration_feedforward", acceleration_feedforward_);
+  priv_nh_.getParam("tracking/slow_down_error", tracking_slow_down_error_);
+  priv_nh_.getParam("tracking/slow_down_scale", tracking_slow_down_scale_);
+  priv_nh_.getParam("tracking/abort_error", tracking_abort_error_);
+  priv_nh_.getParam("tracking/timeout", tracking_timeout_);
+  priv_nh_.getParam("preempt/horizon", preempt_horizon_);
+  priv_nh_.getParam("preempt/blend_time", preempt_blend_time_);
+  priv_nh_.getParam("preempt/velocity_tolerance", preempt_velocity_tolerance_);
+
+  planning_nh_.setCallbackQueue(&planning_queue_);
 
   joint_num_ = JOINT_NUM;
 
-  planned_path_info_.waypoints = 10;
-  planned_path_info_.planned_path_positions = Eigen::MatrixXd::Zero(planned_path_info_.waypoints, joint_num_);
+  if (path_capacity_ < 2)
+  {
+    ROS_WARN("Path capacity must be at least 2 waypoints, not %d, 6000 is used", path_capacity_);
+    path_capacity_ = 6000;
+  }
 
-  move_group = new moveit::planning_interface::MoveGroupInterface("arm");
+  // Allocated once, playback and preemption only work in place
+  planned_path_.init(joint_num_, path_capacity_);
+
+  if (initKinematics())
+  {
+    initServo();
+    initOnlineTrajectory();
+  }
+  else
+    ROS_WARN("Local kinematics is not available, kinematics pose is taken from MoveIt! and servo mode is disabled");
 
   initPublisher(using_gazebo_);
   initSubscriber(using_gazebo_);
 
   initServer();
 
-  if (init_position_ == true)
-    initJointPosition();
+  initMoveGroup();
 }
 
 ArmController::~ArmController()
 {
   ros::shutdown();
+
+  if (planning_spinner_ != NULL)
+  {
+    planning_spinner_->stop();
+    delete planning_spinner_;
+  }
+
+  if (move_group_thread_.joinable())
+    move_group_thread_.join();
+
+  delete move_group;
   return;
 }
 
+void ArmController::initMoveGroup()
+{
+  // MoveGroupInterface blocks until move_group is up, keep the services and the control loop running meanwhile
+  move_group_thread_ = std::thread([this]()
+  {
+    ros::WallTime start_time = ros::WallTime::now();
+
+    try
+    {
+      move_group = new moveit::planning_interface::MoveGroupInterface("arm");
+    }
+    catch (const std::runtime_error &e)
+    {
+      ROS_ERROR("Failed to connect to move_group (arm) : %s", e.what());
+      return;
+    }
+
+    is_move_group_ready_ = true;
+    ROS_INFO("MoveGroupInterface (arm) is ready in %.3f sec", (ros::WallTime::now() - start_time).toSec());
+  });
+}
+
 void ArmController::initJointPosition()
+{
+  // Plan on the planning thread like the services
+  init_position_timer_ = planning_nh_.createWallTimer(ros::WallDuration(0.001), &ArmController::initJointPositionTimerCallback, this, true);
+}
+
+void ArmController::initJointPositionTimerCallback(const ros::WallTimerEvent &event)
 {
   open_manipulator_msgs::JointPosition msg;
 
@@ -75,25 +183,170 @@ void ArmController::initJointPosition()
   calcPlannedPath(msg);
 }
 
+bool ArmController::initKinematics()
+{
+  urdf::Model urdf_model;
+
+  if (urdf_model.initParam("robot_description") == false)
+    return false;
+
+  // Collect the joints from the tip link up to the root and add them base first
+  std::vector<urdf::JointConstSharedPtr> joints;
+  urdf::LinkConstSharedPtr link = urdf_model.getLink(kinematics_tip_link_);
+
+  if (!link)
+  {
+    ROS_WARN("Tip link '%s' is not in the robot description", kinematics_tip_link_.c_str());
+    return false;
+  }
+
+  while (link->getParent())
+  {
+    joints.insert(joints.begin(), link->parent_joint);
+    link = link->getParent();
+  }
+
+  kinematics_base_frame_ = link->name;
+  chain_kinematics_.clear();
+  joint_lower_limit_.clear();
+  joint_upper_limit_.clear();
+
+  for (std::size_t index = 0; index < joints.size(); index++)
+  {
+    const urdf::Pose &pose = joints[index]->parent_to_joint_origin_transform;
+
+    Eigen::Affine3d origin = Eigen::Translation3d(pose.position.x, pose.position.y, pose.position.z)
+                           * Eigen::Quaterniond(pose.rotation.w, pose.rotation.x, pose.rotation.y, pose.rotation.z);
+    Eigen::Vector3d axis(joints[index]->axis.x, joints[index]->axis.y, joints[index]->axis.z);
+
+    ChainJointType type = CHAIN_JOINT_FIXED;
+    switch (joints[index]->type)
+    {
+      case urdf::Joint::REVOLUTE:
+      case urdf::Joint::CONTINUOUS:
+        type = CHAIN_JOINT_REVOLUTE;
+        break;
+      case urdf::Joint::PRISMATIC:
+        type = CHAIN_JOINT_PRISMATIC;
+        break;
+      case urdf::Joint::FIXED:
+        type = CHAIN_JOINT_FIXED;
+        break;
+      default:
+        ROS_WARN("Joint '%s' between %s and %s is not supported",
+                 joints[index]->name.c_str(), kinematics_base_frame_.c_str(), kinematics_tip_link_.c_str());
+        return false;
+    }
+
+    chain_kinematics_.addJoint(joints[index]->name, origin, axis, type);
+
+    if (type == CHAIN_JOINT_FIXED)
+      continue;
+
+    if (joints[index]->type == urdf::Joint::CONTINUOUS || !joints[index]->limits)
+    {
+      joint_lower_limit_.push_back(-std::numeric_limits<double>::infinity());
+      joint_upper_limit_.push_back( std::numeric_limits<double>::infinity());
+    }
+    else
+    {
+      joint_lower_limit_.push_back(joints[index]->limits->lower);
+      joint_upper_limit_.push_back(joints[index]->limits->upper);
+    }
+  }
+
+  present_joint_position_.assign(chain_kinematics_.getJointNum(), 0.0);
+
+  ROS_INFO("Local kinematics : %s -> %s (%d joints)",
+           kinematics_base_frame_.c_str(), kinematics_tip_link_.c_str(), (int)chain_kinematics_.getJointNum());
+
+  return true;
+}
+
+void ArmController::initServo()
+{
+  ServoParam param;
+
+  priv_nh_.param<double>("servo/max_joint_velocity", param.max_joint_velocity, 1.0);
+  priv_nh_.param<double>("servo/joint_limit_margin", param.joint_limit_margin, 0.02);
+  priv_nh_.param<double>("servo/damping",            param.damping,            0.05);
+  priv_nh_.param<double>("servo/singularity_soft",   param.singularity_soft,   0.02);
+  priv_nh_.param<double>("servo/singularity_hard",   param.singularity_hard,   0.005);
+  priv_nh_.param<double>("servo/angular_weight",     param.angular_weight,     0.2);
+
+  chain_servo_.init(&chain_kinematics_, param, joint_lower_limit_, joint_upper_limit_);
+
+  servo_joint_velocity_.assign(chain_kinematics_.getJointNum(), 0.0);
+  servo_joint_position_.assign(chain_kinematics_.getJointNum(), 0.0);
+  servo_filtered_position_.assign(chain_kinematics_.getJointNum(), 0.0);
+  servo_twist_.setZero();
+
+  // Causal smoothing of the streamed setpoint, the jitter of the commands is not passed on
+  SmoothingParam smoothing;
+  std::string smoothing_type;
+
+  priv_nh_.param<std::string>("servo/smoothing/type", smoothing_type, "none");
+  priv_nh_.param<double>("servo/smoothing/cutoff_frequency", smoothing.cutoff_frequency, 10.0);
+  priv_nh_.getParam("servo/smoothing/coefficients", smoothing.coefficients);
+
+  if (!StreamingSmoothingFilter::getType(smoothing_type, smoothing.type))
+  {
+    ROS_WARN("Unknown servo smoothing %s, the setpoint is not smoothed", smoothing_type.c_str());
+    smoothing.type = SMOOTHING_NONE;
+  }
+
+  if (!servo_filter_.init(smoothing, chain_kinematics_.getJointNum(), 1.0 / control_rate_))
+  {
+    ROS_WARN("Invalid servo smoothing parameters, the setpoint is not smoothed");
+    smoothing.type = SMOOTHING_NONE;
+    servo_filter_.init(smoothing, chain_kinematics_.getJointNum(), 1.0 / control_rate_);
+  }
+  else if (smoothing.type != SMOOTHING_NONE)
+  {
+    ROS_INFO("Servo smoothing : %s, group delay %.1f ms", smoothing_type.c_str(), servo_filter_.getGroupDelay() * 1000.0);
+  }
+}
+
+void ArmController::initOnlineTrajectory()
+{
+  const std::vector<std::string> &chain_joint_names = chain_kinematics_.getJointNames();
+  std::vector<MotionLimit> limit(chain_joint_names.size());
+
+  // Same limits as the planner (joint_limits.yaml)
+  for (std::size_t index = 0; index < chain_joint_names.size(); index++)
+  {
+    const std::string prefix = "robot_description_planning/joint_limits/" + chain_joint_names[index] + "/";
+
+    nh_.param<double>(prefix + "max_velocity",     limit[index].max_velocity,     1.0);
+    nh_.param<double>(prefix + "max_acceleration", limit[index].max_acceleration, 1.0);
+    nh_.param<double>(prefix + "max_jerk",         limit[index].max_jerk,         5.0);
+
+    joint_max_acceleration_.push_back(limit[index].max_acceleration);
+  }
+
+  online_trajectory_.init(limit, 1.0 / control_rate_);
+}
+
 void ArmController::initPublisher(bool using_gazebo)
 {
   if (using_gazebo)
   {
     ROS_INFO("SET Gazebo Simulation Mode(Joint)");
 
-    std::string joint_name[joint_num_] = {"joint1", "joint2", "joint3", "joint4"};
+    const std::string prefix = (robot_name_ == "open_manipulator") ? robot_name_ + "/" : "";
 
-    for (uint8_t index = 0; index < joint_num_; index++)
+    if (using_gazebo_group_command_)
     {
-      if (robot_name_ == "open_manipulator")
-      {
-        gazebo_goal_joint_position_pub_[index]
-          = nh_.advertise<std_msgs::Float64>(robot_name_ + "/" + joint_name[index] + "_position/command", 10);
-      }
-      else
+      // JointGroupPositionController over joint1..joint4, see config/gazebo_controller.yaml
+      gazebo_goal_joint_position_pub_ = nh_.advertise<std_msgs::Float64MultiArray>(prefix + "arm_position/command", 10);
+      gazebo_goal_joint_position_.data.assign(joint_num_, 0.0);
+    }
+    else
+    {
+      for (uint8_t index = 0; index < joint_num_; index++)
       {
-        gazebo_goal_joint_position_pub_[index]
-          = nh_.advertise<std_msgs::Float64>(joint_name[index] + "_position/command", 10);
+        gazebo_joint_position_pub_[index]
+          = nh_.advertise<std_msgs::Float64>(prefix + "joint" + std::to_string(index + 1) + "_position/command", 10);
       }
     }
   }
@@ -102,28 +355,62 @@ void ArmController::initPublisher(bool using_gazebo)
     goal_joint_position_pub_ = nh_.advertise<sensor_msgs::JointState>(robot_name_ + "/goal_joint_position", 10);
   }
 
-  arm_state_pub_ = nh_.advertise<open_manipulator_msgs::State>(robot_name_ + "/arm_state", 10);
+  // Written by the playback in every mode, only published without Gazebo
+  goal_joint_position_.position.assign(joint_num_, 0.0);
+  goal_joint_position_.velocity.assign(joint_num_, 0.0);
+
+  tracking_stats_pub_ = nh_.advertise<open_manipulator_position_ctrl::TrackingStats>(robot_name_ + "/tracking_stats", 10);
+
+  for (uint8_t num = 0; num < joint_num_; num++)
+    tracking_stats_.joint_name.push_back("joint" + std::to_string(num + 1));
+
+  tracking_stats_.max_error.assign(joint_num_, 0.0);
+  tracking_stats_.rms_error.assign(joint_num_, 0.0);
 }
 
 void ArmController::initSubscriber(bool using_gazebo)
 {
-  display_planned_path_sub_ = nh_.subscribe("/move_group/display_planned_path", 100,
-                                            &ArmController::displayPlannedPathMsgCallback, this);
+  if (chain_kinematics_.getJointNum() > 0)
+  {
+    joint_states_sub_ = nh_.subscribe(robot_name_ + "/joint_states", 10, &ArmController::jointStatesMsgCallback, this,
+                                      ros::TransportHints().tcpNoDelay());
+
+    servo_twist_sub_ = nh_.subscribe(robot_name_ + "/servo_twist", 1,
+                                     &ArmController::servoTwistMsgCallback, this,
+                                     ros::TransportHints().tcpNoDelay());
+    servo_joint_velocity_sub_ = nh_.subscribe(robot_name_ + "/servo_joint_velocity", 1,
+                                              &ArmController::servoJointVelocityMsgCallback, this,
+                                              ros::TransportHints().tcpNoDelay());
+  }
+
+  speed_override_sub_ = nh_.subscribe(robot_name_ + "/speed_override", 1, &ArmController::speedOverrideMsgCallback, this);
 }
 
 void ArmController::initServer()
 {
-  get_joint_position_server_  = nh_.advertiseService(robot_name_ + "/get_joint_position", &ArmController::getJointPositionMsgCallback, this);
-  get_kinematics_pose_server_ = nh_.advertiseService(robot_name_ + "/get_kinematics_pose", &ArmController::getKinematicsPoseMsgCallback, this);
-  set_joint_position_server_  = nh_.advertiseService(robot_name_ + "/set_joint_position", &ArmController::setJointPositionMsgCallback, this);
-  set_kinematics_pose_server_ = nh_.advertiseService(robot_name_ + "/set_kinematics_pose", &ArmController::setKinematicsPoseMsgCallback, this);
+  // The getters may wait for MoveIt! as well, the control loop keeps spinning the joint states meanwhile
+  get_joint_position_server_  = planning_nh_.advertiseService(robot_name_ + "/get_joint_position", &ArmController::getJointPositionMsgCallback, this);
+  get_kinematics_pose_server_ = planning_nh_.advertiseService(robot_name_ + "/get_kinematics_pose", &ArmController::getKinematicsPoseMsgCallback, this);
+  set_joint_position_server_  = planning_nh_.advertiseService(robot_name_ + "/set_joint_position", &ArmController::setJointPositionMsgCallback, this);
+  set_kinematics_pose_server_ = planning_nh_.advertiseService(robot_name_ + "/set_kinematics_pose", &ArmController::setKinematicsPoseMsgCallback, this);
+
+  planning_spinner_ = new ros::AsyncSpinner(1, &planning_queue_);
+  planning_spinner_->start();
+
+  if (chain_kinematics_.getJointNum() > 0)
+    set_joint_position_online_server_ = nh_.advertiseService(robot_name_ + "/set_joint_position_online", &ArmController::setJointPositionOnlineMsgCallback, this);
 }
 
 bool ArmController::getJointPositionMsgCallback(open_manipulator_msgs::GetJointPosition::Request &req,
                                                 open_manipulator_msgs::GetJointPosition::Response &res)
 {
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
+  if (is_move_group_ready_ == false)
+  {
+    ROS_WARN("MoveIt! is not ready yet");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> move_group_lock(move_group_mutex_);
 
   const std::vector<std::string> &joint_names = move_group->getJointNames();
   std::vector<double> joint_values = move_group->getCurrentJointValues();
@@ -136,25 +423,58 @@ bool ArmController::getJointPositionMsgCallback(open_manipulator_msgs::GetJointP
     res.joint_position.position.push_back(joint_values[i]);
   }
 
-  spinner.stop();
+  return true;
 }
 
 bool ArmController::getKinematicsPoseMsgCallback(open_manipulator_msgs::GetKinematicsPose::Request &req,
                                                  open_manipulator_msgs::GetKinematicsPose::Response &res)
 {
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
+  res.kinematics_pose.group_name = "arm";
+
+  std::unique_lock<std::mutex> joint_states_lock(joint_states_mutex_);
+
+  if (is_joint_states_received_)
+  {
+    Eigen::Affine3d tip_pose;
+    chain_kinematics_.computePose(present_joint_position_.data(), tip_pose);
+
+    res.header.stamp    = joint_states_stamp_;
+    joint_states_lock.unlock();
+
+    const Eigen::Quaterniond orientation(tip_pose.rotation());
+
+    res.header.frame_id = kinematics_base_frame_;
+
+    res.kinematics_pose.pose.position.x    = tip_pose.translation().x();
+    res.kinematics_pose.pose.position.y    = tip_pose.translation().y();
+    res.kinematics_pose.pose.position.z    = tip_pose.translation().z();
+    res.kinematics_pose.pose.orientation.x = orientation.x();
+    res.kinematics_pose.pose.orientation.y = orientation.y();
+    res.kinematics_pose.pose.orientation.z = orientation.z();
+    res.kinematics_pose.pose.orientation.w = orientation.w();
+
+    return true;
+  }
+
+  joint_states_lock.unlock();
+
+  if (is_move_group_ready_ == false)
+  {
+    ROS_WARN("MoveIt! is not ready yet");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> move_group_lock(move_group_mutex_);
 
   const std::string &pose_reference_frame = move_group->getPoseReferenceFrame();
   ROS_INFO("Pose Reference Frame = %s", pose_reference_frame.c_str());
 
   geometry_msgs::PoseStamped current_pose = move_group->getCurrentPose();
 
-  res.header                     = current_pose.header;
-  res.kinematics_pose.group_name = "arm";
-  res.kinematics_pose.pose       = current_pose.pose;
+  res.header                = current_pose.header;
+  res.kinematics_pose.pose  = current_pose.pose;
 
-  spinner.stop();
+  return true;
 }
 
 bool ArmController::setJointPositionMsgCallback(open_manipulator_msgs::SetJointPosition::Request &req,
@@ -165,6 +485,62 @@ bool ArmController::setJointPositionMsgCallback(open_manipulator_msgs::SetJointP
   return true;
 }
 
+bool ArmController::setJointPositionOnlineMsgCallback(open_manipulator_msgs::SetJointPosition::Request &req,
+                                                      open_manipulator_msgs::SetJointPosition::Response &res)
+{
+  const open_manipulator_msgs::JointPosition &msg = req.joint_position;
+  const std::vector<std::string> &chain_joint_names = chain_kinematics_.getJointNames();
+
+  res.isPlanned = false;
+
+  if (is_moving_ || is_servoing_)
+  {
+    ROS_WARN("ROBOT IS WORKING");
+    return true;
+  }
+
+  if (is_joint_states_received_ == false)
+  {
+    ROS_WARN("No joint states yet, online trajectory is not started");
+    return true;
+  }
+
+  // A running motion is retargeted from its present state, otherwise start at rest where the arm is
+  if (is_online_moving_ == false)
+    online_trajectory_.reset(present_joint_position_);
+
+  std::vector<double> target = online_trajectory_.getTarget();
+
+  for (std::size_t num = 0; num < msg.position.size(); num++)
+  {
+    int index = num;
+
+    if (msg.joint_name.size() > num)
+    {
+      std::vector<std::string>::const_iterator it = std::find(chain_joint_names.begin(), chain_joint_names.end(), msg.joint_name[num]);
+      if (it == chain_joint_names.end())
+        continue;
+      index = it - chain_joint_names.begin();
+    }
+
+    if (index < (int)target.size())
+      target[index] = std::max(joint_lower_limit_[index], std::min(joint_upper_limit_[index], msg.position[num]));
+  }
+
+  const double velocity_scale     = (msg.max_velocity_scaling_factor > 0.0) ? msg.max_velocity_scaling_factor : 1.0;
+  const double acceleration_scale = (msg.max_accelerations_scaling_factor > 0.0) ? msg.max_accelerations_scaling_factor : 1.0;
+
+  online_trajectory_.setTarget(target, velocity_scale, acceleration_scale);
+
+  if (is_online_moving_ == false)
+    ROS_INFO("Start Online Trajectory (%.3f sec)", online_trajectory_.getDuration());
+
+  is_online_moving_ = true;
+  res.isPlanned = true;
+
+  return true;
+}
+
 bool ArmController::setKinematicsPoseMsgCallback(open_manipulator_msgs::SetKinematicsPose::Request &req,
                                                  open_manipulator_msgs::SetKinematicsPose::Response &res)
 {
@@ -175,10 +551,20 @@ bool ArmController::setKinematicsPoseMsgCallback(open_manipulator_msgs::SetKinem
 
 bool ArmController::calcPlannedPath(open_manipulator_msgs::KinematicsPose msg)
 {
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
+  if (is_move_group_ready_ == false)
+  {
+    ROS_WARN("MoveIt! is not ready yet, planning is rejected");
+    return false;
+  }
+
+  if (is_servoing_ || is_online_moving_ || is_task_mode_)
+  {
+    ROS_WARN("ROBOT IS WORKING");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> move_group_lock(move_group_mutex_);
 
-  bool isPlanned = false;
   geometry_msgs::Pose target_pose = msg.pose;
 
   move_group->setPoseTarget(target_pose);
@@ -188,39 +574,24 @@ bool ArmController::calcPlannedPath(open_manipulator_msgs::KinematicsPose msg)
 
   move_group->setGoalTolerance(msg.tolerance);
 
-  moveit::planning_interface::MoveGroupInterface::Plan my_plan;
+  return planPreemptive("task space");
+}
 
-  if (is_moving_ == false)
+bool ArmController::calcPlannedPath(open_manipulator_msgs::JointPosition msg)
+{
+  if (is_move_group_ready_ == false)
   {
-    bool success = (move_group->plan(my_plan) == moveit::planning_interface::MoveItErrorCode::SUCCESS);
-
-    if (success)
-    {
-      isPlanned = true;
-    }
-    else
-    {
-      ROS_WARN("Planning (task space goal) is FAILED");
-      isPlanned = false;
-    }
+    ROS_WARN("MoveIt! is not ready yet, planning is rejected");
+    return false;
   }
-  else
+
+  if (is_servoing_ || is_online_moving_ || is_task_mode_)
   {
     ROS_WARN("ROBOT IS WORKING");
-    isPlanned = false;
+    return false;
   }
 
-  spinner.stop();
-
-  return isPlanned;
-}
-
-bool ArmController::calcPlannedPath(open_manipulator_msgs::JointPosition msg)
-{
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
-
-  bool isPlanned = false;
+  std::lock_guard<std::mutex> move_group_lock(move_group_mutex_);
 
   const robot_state::JointModelGroup *joint_model_group = move_group->getCurrentState()->getJointModelGroup("arm");
 
@@ -242,31 +613,114 @@ bool ArmController::calcPlannedPath(open_manipulator_msgs::JointPosition msg)
   move_group->setMaxVelocityScalingFactor(msg.max_velocity_scaling_factor);
   move_group->setMaxAccelerationScalingFactor(msg.max_accelerations_scaling_factor);
 
-  moveit::planning_interface::MoveGroupInterface::Plan my_plan;
+  return planPreemptive("joint space");
+}
+
+bool ArmController::planPreemptive(const char *goal_type)
+{
+  // A moving arm is redirected from the waypoint a horizon ahead, which has to cover the planning time.
+  // The new path is timed from the path velocity there, both are played at the same speed scale.
+  int splice_waypoint = -1;
+  std::vector<double> splice_position, splice_velocity;
 
-  if (is_moving_ == false)
   {
-    bool success = (move_group->plan(my_plan) == moveit::planning_interface::MoveItErrorCode::SUCCESS);
+    std::lock_guard<std::mutex> path_lock(path_mutex_);
 
-    if (success)
+    if (is_moving_)
     {
-      isPlanned = true;
-    }
-    else
-    {
-      ROS_WARN("Planning (joint space goal) is FAILED");
-      isPlanned = false;
+      is_preempt_planning_ = true;
+      splice_waypoint = std::min((int)std::ceil((path_time_ + preempt_horizon_ * speed_scale_) * ITERATION_FREQUENCY),
+                                 (int)all_time_steps_ - 1);
+
+      for (uint8_t num = 0; num < joint_num_; num++)
+      {
+        splice_position.push_back(planned_path_.getPosition(splice_waypoint)[num]);
+        splice_velocity.push_back(planned_path_.getVelocity(splice_waypoint)[num]);
+      }
     }
   }
-  else
+
+  setStartPosition(splice_position, splice_velocity);
+
+  moveit::planning_interface::MoveGroupInterface::Plan my_plan;
+  bool success = (move_group->plan(my_plan) == moveit::planning_interface::MoveItErrorCode::SUCCESS);
+
+  move_group->setStartStateToCurrentState();
+
+  // The echo of a preempting plan may come before or after plan() returns, it is dropped either way
+  std::lock_guard<std::mutex> path_lock(path_mutex_);
+
+  if (splice_waypoint >= 0)
   {
-    ROS_WARN("ROBOT IS WORKING");
-    isPlanned = false;
+    is_preempt_planning_ = false;
+
+    if (success)
+      preempt_echoes_.push_back(my_plan.trajectory_.joint_trajectory);
+    if (preempt_echoes_.size() > PREEMPT_ECHO_NUM)
+      preempt_echoes_.pop_front();
+  }
+
+  if (success == false || my_plan.trajectory_.joint_trajectory.points.empty())
+  {
+    ROS_WARN("Planning (%s goal) is FAILED", goal_type);
+    return false;
+  }
+
+  // At rest the plan is played back from its echo on display_planned_path
+  if (splice_waypoint < 0)
+    return true;
+
+  if (is_moving_ == false || path_time_ * ITERATION_FREQUENCY > splice_waypoint)
+  {
+    ROS_WARN("Planning took longer than the preemption horizon (%.3f sec), the new goal is rejected", preempt_horizon_);
+    return false;
+  }
+
+  // A path that starts slower or in another direction would pull the arm back during the blend
+  const trajectory_msgs::JointTrajectoryPoint &start_point = my_plan.trajectory_.joint_trajectory.points[0];
+  double velocity_error = 0.0;
+
+  for (uint8_t num = 0; num < joint_num_; num++)
+  {
+    const double start_velocity = (start_point.velocities.size() >= joint_num_) ? start_point.velocities[num] : 0.0;
+    velocity_error = std::max(velocity_error, std::fabs(start_velocity - planned_path_.getVelocity(splice_waypoint)[num]));
+  }
+
+  if (velocity_error > preempt_velocity_tolerance_)
+  {
+    ROS_WARN("Planned path leaves the splice point %.3f rad/s off the arm velocity, the new goal is rejected", velocity_error);
+    return false;
+  }
+
+  if (splicePlannedPath(my_plan.trajectory_.joint_trajectory, splice_waypoint) == false)
+  {
+    ROS_WARN("Spliced path exceeds the path capacity (%d), the new goal is rejected", path_capacity_);
+    return false;
+  }
+
+  ROS_INFO("Preempt ARM Planned Path at %.3f sec", (double)splice_waypoint / ITERATION_FREQUENCY);
+  return true;
+}
+
+void ArmController::setStartPosition(const std::vector<double> &start_position, const std::vector<double> &start_velocity)
+{
+  if (start_position.empty())
+  {
+    move_group->setStartStateToCurrentState();
   }
+  else
+  {
+    robot_state::RobotState start_state(*move_group->getCurrentState());
+    start_state.setJointGroupPositions("arm", start_position);
 
-  spinner.stop();
+    // The velocities go with the request to the time parameterization, at rest unless given. The message
+    // of the start state has no accelerations, the path starts without and the splice blend takes up the rest.
+    const std::vector<std::string> &variable_names = start_state.getJointModelGroup("arm")->getVariableNames();
+    for (std::size_t index = 0; index < variable_names.size(); index++)
+      start_state.setVariableVelocity(variable_names[index], (index < start_velocity.size()) ? start_velocity[index] : 0.0);
 
-  return isPlanned;
+    move_group->setStartState(start_state);
+  }
 }
 
 void ArmController::displayPlannedPathMsgCallback(const moveit_msgs::DisplayTrajectory::ConstPtr &msg)
@@ -274,98 +728,588 @@ void ArmController::displayPlannedPathMsgCallback(const moveit_msgs::DisplayTraj
   // Can't find 'grip'
   if (msg->trajectory[0].joint_trajectory.joint_names[0].find("grip") == std::string::npos)
   {
+    // A preempting plan is spliced in by the planner (or rejected), its echo must not be played from where it starts
+    if (isPreemptEcho(msg->trajectory[0].joint_trajectory))
+    {
+      ROS_INFO("Echo of a preempting plan is ignored");
+      return;
+    }
+
+    if (is_moving_ || is_servoing_ || is_online_moving_ || is_task_mode_)
+    {
+      ROS_WARN("ROBOT IS WORKING, planned path is ignored");
+      return;
+    }
+
     ROS_INFO("Get ARM Planned Path");
-    uint8_t joint_num = joint_num_;
+    loadPlannedPath(msg->trajectory[0].joint_trajectory);
+  }
+}
 
-    planned_path_info_.waypoints = msg->trajectory[0].joint_trajectory.points.size();
+bool ArmController::isPreemptEcho(const trajectory_msgs::JointTrajectory &trajectory)
+{
+  std::lock_guard<std::mutex> path_lock(path_mutex_);
 
-    planned_path_info_.planned_path_positions.resize(planned_path_info_.waypoints, joint_num);
+  if (is_preempt_planning_)
+    return true;
 
-    for (uint16_t point_num = 0; point_num < planned_path_info_.waypoints; point_num++)
-    {
-      for (uint8_t num = 0; num < joint_num; num++)
-      {
-        float joint_position = msg->trajectory[0].joint_trajectory.points[point_num].positions[num];
+  if (trajectory.points.empty())
+    return false;
 
-        planned_path_info_.planned_path_positions.coeffRef(point_num , num) = joint_position;
-      }
+  for (std::deque<trajectory_msgs::JointTrajectory>::iterator it = preempt_echoes_.begin(); it != preempt_echoes_.end(); ++it)
+  {
+    const std::vector<trajectory_msgs::JointTrajectoryPoint> &points = it->points;
+
+    if (points.size() == trajectory.points.size() &&
+        points.back().time_from_start == trajectory.points.back().time_from_start &&
+        points.front().positions == trajectory.points.front().positions &&
+        points.back().positions == trajectory.points.back().positions)
+    {
+      preempt_echoes_.erase(it);
+      return true;
     }
+  }
 
-    all_time_steps_ = planned_path_info_.waypoints;
+  return false;
+}
 
-    ros::WallDuration sleep_time(0.5);
-    sleep_time.sleep();
+bool ArmController::planPath(const geometry_msgs::Pose &target_pose, const std::vector<double> &start_position,
+                             double velocity_scale, double acceleration_scale, trajectory_msgs::JointTrajectory &trajectory)
+{
+  if (is_move_group_ready_ == false)
+  {
+    ROS_WARN("MoveIt! is not ready yet, planning is rejected");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> move_group_lock(move_group_mutex_);
+
+  setStartPosition(start_position);
+
+  move_group->setPoseTarget(target_pose);
 
-    is_moving_  = true;    
+  move_group->setMaxVelocityScalingFactor(velocity_scale);
+  move_group->setMaxAccelerationScalingFactor(acceleration_scale);
+
+  moveit::planning_interface::MoveGroupInterface::Plan my_plan;
+  bool success = (move_group->plan(my_plan) == moveit::planning_interface::MoveItErrorCode::SUCCESS);
+
+  move_group->setStartStateToCurrentState();
+
+  if (success == false || my_plan.trajectory_.joint_trajectory.points.empty())
+  {
+    ROS_WARN("Planning (task space goal) is FAILED");
+    return false;
   }
+
+  trajectory = my_plan.trajectory_.joint_trajectory;
+  return true;
 }
 
-void ArmController::process(void)
+bool ArmController::startPath(const trajectory_msgs::JointTrajectory &trajectory)
 {
-  static uint16_t step_cnt = 0;
-  std_msgs::Float64 gazebo_goal_joint_position;
-  sensor_msgs::JointState goal_joint_position;
-  goal_joint_position.header.stamp = ros::Time::now();
-  open_manipulator_msgs::State state;
+  if (is_moving_ || is_servoing_ || is_online_moving_)
+  {
+    ROS_WARN("ROBOT IS WORKING");
+    return false;
+  }
 
-  if (is_moving_)
+  return loadPlannedPath(trajectory);
+}
+
+PathResult ArmController::getPathResult(void)
+{
+  std::lock_guard<std::mutex> path_lock(path_mutex_);
+  return path_result_;
+}
+
+bool ArmController::loadPlannedPath(const trajectory_msgs::JointTrajectory &trajectory)
+{
+  if (trajectory.points.empty())
+    return false;
+
+  if (trajectory.points.size() > planned_path_.getCapacity())
+  {
+    ROS_WARN("Planned path has %d waypoints, more than the path capacity (%d), it is ignored",
+             (int)trajectory.points.size(), path_capacity_);
+    return false;
+  }
+
+  for (std::size_t point_num = 0; point_num < trajectory.points.size(); point_num++)
   {
-    if (using_gazebo_)
+    if (trajectory.points[point_num].positions.size() < joint_num_)
     {
-      for (uint8_t num = 0; num < joint_num_; num++)
-      {
-        gazebo_goal_joint_position.data = planned_path_info_.planned_path_positions(step_cnt, num);
-        gazebo_goal_joint_position_pub_[num].publish(gazebo_goal_joint_position);
-      }
-      step_cnt++;
+      ROS_WARN("Planned path has fewer positions than arm joints, it is ignored");
+      return false;
     }
-    else
+  }
+
+  std::lock_guard<std::mutex> path_lock(path_mutex_);
+
+  planned_path_.clear();
+
+  for (std::size_t point_num = 0; point_num < trajectory.points.size(); point_num++)
+  {
+    const trajectory_msgs::JointTrajectoryPoint &point = trajectory.points[point_num];
+    planned_path_.push(point.positions.data(), NULL, point.time_from_start.toSec());
+  }
+
+  // The planned velocities belong to time_from_start, playback runs at 1 / ITERATION_FREQUENCY per waypoint
+  updatePathVelocity(0, planned_path_.getSize());
+
+  all_time_steps_ = planned_path_.getSize();
+  path_time_      = 0.0;
+  speed_scale_    = speed_override_;
+
+  resetTrackingStats();
+
+  is_moving_   = true;
+  path_result_ = PATH_PLAYING;
+  return true;
+}
+
+void ArmController::jointStatesMsgCallback(const sensor_msgs::JointState::ConstPtr &msg)
+{
+  const std::vector<std::string> &chain_joint_names = chain_kinematics_.getJointNames();
+
+  // Resolve the message layout once; it only changes if the publisher changes
+  if (joint_states_index_.size() != chain_joint_names.size() ||
+      std::find(joint_states_index_.begin(), joint_states_index_.end(), -1) != joint_states_index_.end())
+  {
+    joint_states_index_.assign(chain_joint_names.size(), -1);
+
+    for (std::size_t index = 0; index < chain_joint_names.size(); index++)
     {
-      for (uint8_t num = 0; num < joint_num_; num++)
+      for (std::size_t name_num = 0; name_num < msg->name.size(); name_num++)
       {
-        goal_joint_position.position.push_back(planned_path_info_.planned_path_positions(step_cnt, num));
+        if (msg->name[name_num] == chain_joint_names[index])
+          joint_states_index_[index] = name_num;
       }
+    }
+  }
+
+  std::lock_guard<std::mutex> joint_states_lock(joint_states_mutex_);
+
+  for (std::size_t index = 0; index < joint_states_index_.size(); index++)
+  {
+    const int msg_index = joint_states_index_[index];
 
-      goal_joint_position_pub_.publish(goal_joint_position);
-      step_cnt++;
+    if (msg_index < 0 || msg_index >= (int)msg->position.size() || msg->name[msg_index] != chain_joint_names[index])
+    {
+      joint_states_index_.clear();
+      return;
     }
 
-    if (step_cnt >= all_time_steps_)
+    present_joint_position_[index] = msg->position[msg_index];
+  }
+
+  joint_states_stamp_ = msg->header.stamp;
+  is_joint_states_received_ = true;
+}
+
+void ArmController::servoTwistMsgCallback(const geometry_msgs::TwistStamped::ConstPtr &msg)
+{
+  if (msg->header.frame_id != "" && msg->header.frame_id != kinematics_base_frame_)
+  {
+    ROS_WARN_THROTTLE(1.0, "Servo twist must be given in %s, not %s", kinematics_base_frame_.c_str(), msg->header.frame_id.c_str());
+    return;
+  }
+
+  servo_twist_ << msg->twist.linear.x,  msg->twist.linear.y,  msg->twist.linear.z,
+                  msg->twist.angular.x, msg->twist.angular.y, msg->twist.angular.z;
+
+  is_twist_command_   = true;
+  servo_command_time_ = ros::Time::now();
+
+  startServo();
+}
+
+void ArmController::servoJointVelocityMsgCallback(const sensor_msgs::JointState::ConstPtr &msg)
+{
+  const std::vector<std::string> &chain_joint_names = chain_kinematics_.getJointNames();
+
+  std::fill(servo_joint_velocity_.begin(), servo_joint_velocity_.end(), 0.0);
+
+  // Without names the velocities are taken in chain order
+  for (std::size_t num = 0; num < msg->velocity.size(); num++)
+  {
+    if (msg->name.empty())
     {
-      is_moving_ = false;
-      step_cnt   = 0;
+      if (num < servo_joint_velocity_.size())
+        servo_joint_velocity_[num] = msg->velocity[num];
+      continue;
+    }
+
+    if (num >= msg->name.size())
+      break;
+
+    std::vector<std::string>::const_iterator it = std::find(chain_joint_names.begin(), chain_joint_names.end(), msg->name[num]);
+    if (it != chain_joint_names.end())
+      servo_joint_velocity_[it - chain_joint_names.begin()] = msg->velocity[num];
+  }
 
-      ROS_INFO("Complete Execution");
+  is_twist_command_   = false;
+  servo_command_time_ = ros::Time::now();
+
+  startServo();
+}
+
+bool ArmController::startServo(void)
+{
+  if (is_servoing_)
+    return true;
+
+  if (is_moving_ || is_online_moving_)
+  {
+    ROS_WARN_THROTTLE(1.0, "ROBOT IS WORKING, servo command is ignored");
+    return false;
+  }
+
+  if (is_joint_states_received_ == false)
+  {
+    ROS_WARN_THROTTLE(1.0, "No joint states yet, servo command is ignored");
+    return false;
+  }
+
+  // Integrate from the measured position once, then from the commanded one so the
+  // servo does not droop by the tracking lag of the actuators
+  servo_joint_position_ = present_joint_position_;
+  servo_filtered_position_ = present_joint_position_;
+  servo_filter_.reset(servo_joint_position_.data());
+  is_servoing_ = true;
+
+  ROS_INFO("Start Servo");
+  return true;
+}
+
+void ArmController::publishGoalJointPosition(const double *position)
+{
+  if (using_gazebo_ && using_gazebo_group_command_)
+  {
+    for (uint8_t num = 0; num < joint_num_; num++)
+    {
+      gazebo_goal_joint_position_.data[num] = position[num];
     }
 
-    state.robot = state.IS_MOVING;
-    arm_state_pub_.publish(state);
+    gazebo_goal_joint_position_pub_.publish(gazebo_goal_joint_position_);
+  }
+  else if (using_gazebo_)
+  {
+    for (uint8_t num = 0; num < joint_num_; num++)
+    {
+      gazebo_joint_position_.data = position[num];
+      gazebo_joint_position_pub_[num].publish(gazebo_joint_position_);
+    }
   }
   else
   {
-    state.robot = state.STOPPED;
-    arm_state_pub_.publish(state);
+    goal_joint_position_.header.stamp = ros::Time::now();
+
+    for (uint8_t num = 0; num < joint_num_; num++)
+    {
+      goal_joint_position_.position[num] = position[num];
+    }
+
+    goal_joint_position_pub_.publish(goal_joint_position_);
+  }
+}
+
+void ArmController::processPlannedPath(void)
+{
+  std::lock_guard<std::mutex> path_lock(path_mutex_);
+
+  // Sample the path at its nominal time, linear between waypoints
+  const double path_index = path_time_ * ITERATION_FREQUENCY;
+  const uint32_t waypoint = std::min((uint32_t)path_index, all_time_steps_ - 1);
+  const double ratio = std::min(1.0, path_index - waypoint);
+  const uint32_t next_waypoint = std::min(waypoint + 1, all_time_steps_ - 1);
+
+  const double *position      = planned_path_.getPosition(waypoint);
+  const double *next_position = planned_path_.getPosition(next_waypoint);
+  const double *velocity      = planned_path_.getVelocity(waypoint);
+  const double *next_velocity = planned_path_.getVelocity(next_waypoint);
+
+  double reference_position[JOINT_NUM];
+  double goal_joint_position[JOINT_NUM];
+
+  for (uint8_t num = 0; num < joint_num_; num++)
+  {
+    const double reference_velocity     = (velocity[num] * (1.0 - ratio) + next_velocity[num] * ratio) * speed_scale_;
+    const double reference_acceleration = (next_velocity[num] - velocity[num]) * ITERATION_FREQUENCY * speed_scale_ * speed_scale_;
+
+    reference_position[num]  = position[num] * (1.0 - ratio) + next_position[num] * ratio;
+    goal_joint_position[num] = reference_position[num]
+                             + velocity_feedforward_ * reference_velocity
+                             + acceleration_feedforward_ * reference_acceleration;
+
+    goal_joint_position_.velocity[num] = reference_velocity;
   }
+
+  if (updateTrackingError(reference_position) == false)
+  {
+    // Hold where the arm is, it is blocked or far behind
+    publishGoalJointPosition(present_joint_position_.data());
+
+    is_moving_   = false;
+    path_result_ = PATH_ABORTED;
+    path_time_   = 0.0;
+
+    ROS_ERROR("Tracking error exceeds %.3f rad, execution is aborted", tracking_abort_error_);
+    publishTrackingStats(open_manipulator_position_ctrl::TrackingStats::ABORTED);
+    return;
+  }
+
+  publishGoalJointPosition(goal_joint_position);
+
+  if (path_index >= all_time_steps_ - 1)
+  {
+    is_moving_   = false;
+    path_result_ = PATH_COMPLETED;
+    path_time_   = 0.0;
+
+    ROS_INFO("Complete Execution");
+    publishTrackingStats(open_manipulator_position_ctrl::TrackingStats::COMPLETED);
+    return;
+  }
+
+  updateSpeedScale(waypoint);
+  path_time_ += speed_scale_ / control_rate_;
 }
 
-int main(int argc, char **argv)
+bool ArmController::splicePlannedPath(const trajectory_msgs::JointTrajectory &trajectory, int splice_waypoint)
 {
-  ros::init(argc, argv, "joint_controller_for_OpenManipulator");
+  // The new path leaves the splice waypoint at the velocity of the old one. Blending from the old into the
+  // new path takes up the rest (the acceleration, the velocity across the new path), the quintic weight has
+  // zero slope and curvature at both ends so velocity and acceleration stay continuous without a stop.
+  // Every waypoint only reads its own old value, so the path is rewritten in place.
+  const int blend_steps   = std::max(1, (int)(preempt_blend_time_ * ITERATION_FREQUENCY));
+  const int new_waypoints = trajectory.points.size();
+  const int old_waypoints = all_time_steps_;
+  const int waypoints     = splice_waypoint + std::max(new_waypoints, blend_steps + 1);
 
-  ros::WallDuration sleep_time(3.0);
-  sleep_time.sleep();
+  if (planned_path_.resize(waypoints) == false)
+    return false;
 
-  ArmController controller;
+  const double splice_time = planned_path_.getTime(splice_waypoint);
 
-  ros::Rate loop_rate(ITERATION_FREQUENCY);
+  // The old path holds its end, which is overwritten on the way
+  double old_end_position[JOINT_NUM];
+  std::copy(planned_path_.getPosition(old_waypoints - 1), planned_path_.getPosition(old_waypoints - 1) + joint_num_, old_end_position);
 
-  while (ros::ok())
+  for (int step = 0; step < waypoints - splice_waypoint; step++)
   {
-    controller.process();
+    const int new_waypoint = std::min(step, new_waypoints - 1);
+    const double *old_position = (splice_waypoint + step < old_waypoints) ? planned_path_.getPosition(splice_waypoint + step)
+                                                                          : old_end_position;
+    const std::vector<double> &new_position = trajectory.points[new_waypoint].positions;
+
+    const double ratio  = std::min(1.0, (double)step / blend_steps);
+    const double weight = ratio * ratio * ratio * (10.0 - 15.0 * ratio + 6.0 * ratio * ratio);
+
+    double *position = planned_path_.getPosition(splice_waypoint + step);
 
-    ros::spinOnce();
-    loop_rate.sleep();
+    for (uint8_t num = 0; num < joint_num_; num++)
+      position[num] = (1.0 - weight) * old_position[num] + weight * new_position[num];
+
+    planned_path_.setTime(splice_waypoint + step, splice_time + (double)step / ITERATION_FREQUENCY);
   }
 
-  return 0;
+  updatePathVelocity(splice_waypoint, waypoints);
+
+  all_time_steps_ = waypoints;
+  return true;
+}
+
+void ArmController::updatePathVelocity(uint32_t first_waypoint, uint32_t last_waypoint)
+{
+  // Central differences at the playback spacing, both ends of the path rest
+  const uint32_t waypoints = planned_path_.getSize();
+
+  for (uint32_t waypoint = first_waypoint; waypoint < last_waypoint; waypoint++)
+  {
+    double *velocity = planned_path_.getVelocity(waypoint);
+
+    for (uint8_t num = 0; num < joint_num_; num++)
+    {
+      velocity[num] = (waypoint + 1 < waypoints && waypoint > 0)
+                    ? (planned_path_.getPosition(waypoint + 1)[num] - planned_path_.getPosition(waypoint - 1)[num]) * 0.5 * ITERATION_FREQUENCY
+                    : 0.0;
+    }
+  }
+}
+
+void ArmController::resetTrackingStats(void)
+{
+  tracking_stats_.header.stamp   = ros::Time::now();
+  tracking_stats_.slow_down_time = 0.0;
+
+  std::fill(tracking_stats_.max_error.begin(), tracking_stats_.max_error.end(), 0.0);
+  std::fill(tracking_stats_.rms_error.begin(), tracking_stats_.rms_error.end(), 0.0);
+
+  tracking_sample_num_ = 0;
+  is_tracking_slowed_  = false;
+}
+
+bool ArmController::updateTrackingError(const double *reference_position)
+{
+  if (is_joint_states_received_ == false || (ros::Time::now() - joint_states_stamp_).toSec() > tracking_timeout_)
+  {
+    is_tracking_slowed_ = false;
+    return true;
+  }
+
+  double max_error = 0.0;
+
+  for (uint8_t num = 0; num < joint_num_ && num < present_joint_position_.size(); num++)
+  {
+    const double error = std::fabs(reference_position[num] - present_joint_position_[num]);
+
+    tracking_stats_.max_error[num]  = std::max(tracking_stats_.max_error[num], error);
+    tracking_stats_.rms_error[num] += error * error;       // sum of squares until published
+    max_error = std::max(max_error, error);
+  }
+
+  tracking_sample_num_++;
+
+  if (max_error > tracking_abort_error_)
+    return false;
+
+  is_tracking_slowed_ = (max_error > tracking_slow_down_error_);
+
+  if (is_tracking_slowed_)
+    tracking_stats_.slow_down_time += 1.0 / control_rate_;
+
+  return true;
+}
+
+void ArmController::publishTrackingStats(const std::string &result)
+{
+  const ros::Time now = ros::Time::now();
+
+  tracking_stats_.duration = (now - tracking_stats_.header.stamp).toSec();
+  tracking_stats_.header.stamp = now;
+  tracking_stats_.result = result;
+
+  for (uint8_t num = 0; num < joint_num_; num++)
+    tracking_stats_.rms_error[num] = (tracking_sample_num_ > 0) ? std::sqrt(tracking_stats_.rms_error[num] / tracking_sample_num_) : 0.0;
+
+  tracking_stats_pub_.publish(tracking_stats_);
+
+  is_tracking_slowed_ = false;
+}
+
+void ArmController::updateSpeedScale(uint32_t waypoint)
+{
+  const double target_scale = is_tracking_slowed_ ? speed_override_ * tracking_slow_down_scale_ : speed_override_;
+
+  if (speed_scale_ == target_scale)
+    return;
+
+  // Playing the path at scale s gives q'(t) s and q''(t) s^2 + q'(t) ds/dt, so the rate of change
+  // is bounded by what the path leaves of the acceleration limit. The lower bound keeps a path that
+  // is planned at the limit from locking its speed.
+  double max_rate = speed_override_max_rate_;
+
+  if (waypoint > 0 && waypoint + 1 < all_time_steps_)
+  {
+    for (uint8_t num = 0; num < joint_max_acceleration_.size() && num < joint_num_; num++)
+    {
+      const double previous_position = planned_path_.getPosition(waypoint - 1)[num];
+      const double position          = planned_path_.getPosition(waypoint)[num];
+      const double next_position     = planned_path_.getPosition(waypoint + 1)[num];
+
+      const double velocity     = (next_position - previous_position) * 0.5 * ITERATION_FREQUENCY;
+      const double acceleration = (next_position - 2.0 * position + previous_position) * ITERATION_FREQUENCY * ITERATION_FREQUENCY;
+      const double margin       = joint_max_acceleration_[num] - std::fabs(acceleration) * speed_scale_ * speed_scale_;
+
+      if (std::fabs(velocity) > 1e-6)
+        max_rate = std::min(max_rate, std::max(0.0, margin) / std::fabs(velocity));
+    }
+  }
+
+  const double max_step = std::max(max_rate, speed_override_min_rate_) / control_rate_;
+
+  speed_scale_ += std::max(-max_step, std::min(max_step, target_scale - speed_scale_));
+}
+
+void ArmController::speedOverrideMsgCallback(const std_msgs::Float64::ConstPtr &msg)
+{
+  const double speed_override = std::max(0.0, std::min(100.0, msg->data)) / 100.0;
+
+  if (speed_override != speed_override_)
+    ROS_INFO("Speed override %.0f %%", speed_override * 100.0);
+
+  speed_override_ = speed_override;
+}
+
+void ArmController::processServo(void)
+{
+  // Deadman: the commands have to keep coming, otherwise hold the last setpoint
+  if ((ros::Time::now() - servo_command_time_).toSec() > servo_timeout_)
+  {
+    // The smoothed setpoint lags, let it settle on the last one before holding
+    double settle_error = 0.0;
+    for (std::size_t index = 0; index < servo_joint_position_.size(); index++)
+      settle_error = std::max(settle_error, std::fabs(servo_joint_position_[index] - servo_filtered_position_[index]));
+
+    if (settle_error > SERVO_SETTLE_TOLERANCE)
+    {
+      servo_filter_.update(servo_joint_position_.data(), servo_filtered_position_.data());
+      publishGoalJointPosition(servo_filtered_position_.data());
+      return;
+    }
+
+    is_servoing_ = false;
+
+    ROS_INFO("Stop Servo (no command for %.3f sec)", servo_timeout_);
+    return;
+  }
+
+  ServoStatus status;
+  const double period = 1.0 / control_rate_;
+
+  if (is_twist_command_)
+    status = chain_servo_.stepTwist(servo_twist_, period, servo_joint_position_);
+  else
+    status = chain_servo_.stepJointVelocity(servo_joint_velocity_, period, servo_joint_position_);
+
+  if (status == SERVO_SINGULAR)
+    ROS_WARN_THROTTLE(1.0, "Servo command is stopped near a singularity");
+  else if (status == SERVO_JOINT_LIMITED)
+    ROS_WARN_THROTTLE(1.0, "Servo command is stopped at a joint limit");
+
+  servo_filter_.update(servo_joint_position_.data(), servo_filtered_position_.data());
+  publishGoalJointPosition(servo_filtered_position_.data());
+}
+
+void ArmController::processOnlineTrajectory(void)
+{
+  const bool is_moving = online_trajectory_.update();
+  const std::vector<MotionState> &state = online_trajectory_.getState();
+
+  double goal_joint_position[JOINT_NUM];
+
+  for (uint8_t num = 0; num < joint_num_; num++)
+  {
+    goal_joint_position[num] = state[num].position;
+  }
+
+  publishGoalJointPosition(goal_joint_position);
+
+  if (is_moving == false)
+  {
+    is_online_moving_ = false;
+
+    ROS_INFO("Complete Execution");
+  }
+}
+
+void ArmController::process(void)
+{
+  if (is_moving_)
+    processPlannedPath();
+  else if (is_online_moving_)
+    processOnlineTrajectory();
+  else if (is_servoing_)
+    processServo();
 }
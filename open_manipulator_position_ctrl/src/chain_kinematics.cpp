@@ -0,0 +1,112 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_position_ctrl/chain_kinematics.h"
+
+using namespace open_manipulator;
+
+ChainKinematics::ChainKinematics()
+{
+  clear();
+}
+
+void ChainKinematics::clear()
+{
+  segments_.clear();
+  joint_names_.clear();
+  pending_origin_.setIdentity();
+}
+
+void ChainKinematics::addJoint(const std::string &name, const Eigen::Affine3d &origin,
+                               const Eigen::Vector3d &axis, ChainJointType type)
+{
+  if (type == CHAIN_JOINT_FIXED)
+  {
+    pending_origin_ = pending_origin_ * origin;
+    return;
+  }
+
+  ChainSegment segment;
+  segment.origin = pending_origin_ * origin;
+  segment.axis   = axis.normalized();
+  segment.type   = type;
+
+  segments_.push_back(segment);
+  joint_names_.push_back(name);
+
+  pending_origin_.setIdentity();
+}
+
+void ChainKinematics::computePose(const double *position, Eigen::Affine3d &tip_pose) const
+{
+  tip_pose.setIdentity();
+
+  for (std::size_t index = 0; index < segments_.size(); index++)
+  {
+    const ChainSegment &segment = segments_[index];
+
+    tip_pose = tip_pose * segment.origin;
+
+    if (segment.type == CHAIN_JOINT_REVOLUTE)
+      tip_pose.rotate(Eigen::AngleAxisd(position[index], segment.axis));
+    else
+      tip_pose.translate(segment.axis * position[index]);
+  }
+
+  tip_pose = tip_pose * pending_origin_;
+}
+
+void ChainKinematics::computeJacobian(const double *position, Eigen::MatrixXd &jacobian) const
+{
+  Eigen::Affine3d frame = Eigen::Affine3d::Identity();
+
+  jacobian.resize(6, segments_.size());
+
+  // Joint axes and origins in the base frame first, the tip position is known only at the end
+  for (std::size_t index = 0; index < segments_.size(); index++)
+  {
+    const ChainSegment &segment = segments_[index];
+
+    frame = frame * segment.origin;
+
+    const Eigen::Vector3d axis = frame.linear() * segment.axis;
+
+    jacobian.block<3, 1>(0, index) = frame.translation();
+    jacobian.block<3, 1>(3, index) = axis;
+
+    if (segment.type == CHAIN_JOINT_REVOLUTE)
+      frame.rotate(Eigen::AngleAxisd(position[index], segment.axis));
+    else
+      frame.translate(segment.axis * position[index]);
+  }
+
+  const Eigen::Vector3d tip_position = (frame * pending_origin_).translation();
+
+  for (std::size_t index = 0; index < segments_.size(); index++)
+  {
+    const Eigen::Vector3d axis = jacobian.block<3, 1>(3, index);
+
+    if (segments_[index].type == CHAIN_JOINT_REVOLUTE)
+    {
+      jacobian.block<3, 1>(0, index) = axis.cross(tip_position - jacobian.block<3, 1>(0, index));
+    }
+    else
+    {
+      jacobian.block<3, 1>(0, index) = axis;
+      jacobian.block<3, 1>(3, index).setZero();
+    }
+  }
+}
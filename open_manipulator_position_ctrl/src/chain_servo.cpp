@@ -0,0 +1,149 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_position_ctrl/chain_servo.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace open_manipulator;
+
+ChainServo::ChainServo()
+    :kinematics_(NULL)
+{
+  param_.max_joint_velocity = 1.0;
+  param_.joint_limit_margin = 0.02;
+  param_.damping            = 0.05;
+  param_.singularity_soft   = 0.02;
+  param_.singularity_hard   = 0.005;
+  param_.angular_weight     = 0.2;
+}
+
+void ChainServo::init(const ChainKinematics *kinematics, const ServoParam &param,
+                      const std::vector<double> &lower_limit, const std::vector<double> &upper_limit)
+{
+  kinematics_  = kinematics;
+  param_       = param;
+  lower_limit_ = lower_limit;
+  upper_limit_ = upper_limit;
+
+  jacobian_.resize(6, kinematics_->getJointNum());
+  joint_velocity_.resize(kinematics_->getJointNum());
+  next_position_.resize(kinematics_->getJointNum());
+}
+
+double ChainServo::smallestSingularValue(const double *position)
+{
+  kinematics_->computeJacobian(position, jacobian_);
+  jacobian_.bottomRows<3>() *= param_.angular_weight;
+
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd(jacobian_);
+  return svd.singularValues().minCoeff();
+}
+
+ServoStatus ChainServo::stepTwist(const Eigen::Matrix<double, 6, 1> &twist, double period, std::vector<double> &position)
+{
+  kinematics_->computeJacobian(position.data(), jacobian_);
+  jacobian_.bottomRows<3>() *= param_.angular_weight;
+
+  Eigen::Matrix<double, 6, 1> weighted_twist = twist;
+  weighted_twist.tail<3>() *= param_.angular_weight;
+
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd(jacobian_, Eigen::ComputeThinU | Eigen::ComputeThinV);
+  const Eigen::VectorXd &sigma = svd.singularValues();
+  const double sigma_min = sigma.minCoeff();
+
+  // Damping only near the singularity so the solution stays exact elsewhere
+  double damping_squared = 0.0;
+  if (sigma_min < param_.singularity_soft)
+  {
+    const double ratio = sigma_min / param_.singularity_soft;
+    damping_squared = (1.0 - ratio * ratio) * param_.damping * param_.damping;
+  }
+
+  const Eigen::VectorXd projected = svd.matrixU().transpose() * weighted_twist;
+  Eigen::VectorXd scaled(sigma.size());
+  for (int index = 0; index < sigma.size(); index++)
+    scaled(index) = sigma(index) / (sigma(index) * sigma(index) + damping_squared) * projected(index);
+
+  joint_velocity_ = svd.matrixV() * scaled;
+
+  ServoStatus status = SERVO_OK;
+
+  // Slow down linearly between the soft and hard thresholds, stop anything that crosses the hard one
+  if (sigma_min < param_.singularity_soft)
+  {
+    for (std::size_t index = 0; index < position.size(); index++)
+      next_position_[index] = position[index] + joint_velocity_(index) * period;
+
+    const double next_sigma_min = smallestSingularValue(next_position_.data());
+
+    if (next_sigma_min < sigma_min)
+    {
+      if (next_sigma_min < param_.singularity_hard)
+      {
+        joint_velocity_.setZero();
+        return SERVO_SINGULAR;
+      }
+
+      joint_velocity_ *= (sigma_min - param_.singularity_hard) / (param_.singularity_soft - param_.singularity_hard);
+      status = SERVO_SCALED;
+    }
+  }
+
+  ServoStatus limit_status = applyLimits(period, position);
+  return (limit_status != SERVO_OK) ? limit_status : status;
+}
+
+ServoStatus ChainServo::stepJointVelocity(const std::vector<double> &velocity, double period, std::vector<double> &position)
+{
+  for (std::size_t index = 0; index < position.size(); index++)
+    joint_velocity_(index) = velocity[index];
+
+  return applyLimits(period, position);
+}
+
+ServoStatus ChainServo::applyLimits(double period, std::vector<double> &position)
+{
+  ServoStatus status = SERVO_OK;
+
+  // Scale the whole vector so the direction of motion is kept
+  const double max_velocity = joint_velocity_.cwiseAbs().maxCoeff();
+  if (max_velocity > param_.max_joint_velocity)
+  {
+    joint_velocity_ *= param_.max_joint_velocity / max_velocity;
+    status = SERVO_SCALED;
+  }
+
+  for (std::size_t index = 0; index < position.size(); index++)
+  {
+    const double lower = lower_limit_[index] + param_.joint_limit_margin;
+    const double upper = upper_limit_[index] - param_.joint_limit_margin;
+    const double target = position[index] + joint_velocity_(index) * period;
+
+    if ((target < lower && joint_velocity_(index) < 0.0) || (target > upper && joint_velocity_(index) > 0.0))
+    {
+      position[index] = std::max(std::min(position[index], upper), lower);
+      status = SERVO_JOINT_LIMITED;
+    }
+    else
+    {
+      position[index] = target;
+    }
+  }
+
+  return status;
+}
@@ -18,59 +18,158 @@
 
 #include "open_manipulator_position_ctrl/gripper_controller.h"
 
+#include <urdf/model.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
 using namespace open_manipulator;
 
-GripperController::GripperController()
+GripperController::GripperController(ros::CallbackQueue *planning_queue)
     :priv_nh_("~"),
      using_gazebo_(false),
+     using_gazebo_group_command_(false),
      robot_name_(""),
+     control_rate_(CONTROL_FREQUENCY),
      palm_num_(2),
-     is_moving_(false)
+     is_joint_states_received_(false),
+     is_online_moving_(false),
+     grip_current_(50.0),
+     release_current_(50.0),
+     goal_current_(0.0),
+     grasp_current_threshold_(40.0),
+     grasp_stall_velocity_(0.002),
+     grasp_stall_time_(0.05),
+     grasp_settle_time_(0.2),
+     present_gripper_current_(0.0),
+     present_gripper_velocity_(0.0),
+     is_grasping_(false),
+     is_moving_(false),
+     step_cnt_(0),
+     path_step_time_(0.0),
+     move_group(NULL),
+     is_move_group_ready_(false)
 {
   // Init parameter
   nh_.getParam("gazebo", using_gazebo_);
+  nh_.getParam("gazebo_group_command", using_gazebo_group_command_);
   nh_.getParam("robot_name", robot_name_);
+  priv_nh_.getParam("control_rate", control_rate_);
+  priv_nh_.getParam("gripper/grip_current", grip_current_);
+  priv_nh_.getParam("gripper/release_current", release_current_);
+  priv_nh_.getParam("gripper/grasp_current_threshold", grasp_current_threshold_);
+  priv_nh_.getParam("gripper/grasp_stall_velocity", grasp_stall_velocity_);
+  priv_nh_.getParam("gripper/grasp_stall_time", grasp_stall_time_);
+  priv_nh_.getParam("gripper/grasp_settle_time", grasp_settle_time_);
 
-  planned_path_info_.waypoints = 10;
-  planned_path_info_.planned_path_positions = Eigen::MatrixXd::Zero(planned_path_info_.waypoints, 2);
+  planning_nh_.setCallbackQueue(planning_queue);
 
-  move_group = new moveit::planning_interface::MoveGroupInterface("gripper");
+  // Allocated once, gripper paths are short
+  planned_path_.init(palm_num_, 1000);
+
+  initOnlineTrajectory();
 
   initPublisher(using_gazebo_);
   initSubscriber(using_gazebo_);
 
   initServer();
+
+  initMoveGroup();
 }
 
 GripperController::~GripperController()
 {
   ros::shutdown();
+
+  if (move_group_thread_.joinable())
+    move_group_thread_.join();
+
+  delete move_group;
   return;
 }
 
+void GripperController::initMoveGroup()
+{
+  // MoveGroupInterface blocks until move_group is up, keep the services and the control loop running meanwhile
+  move_group_thread_ = std::thread([this]()
+  {
+    ros::WallTime start_time = ros::WallTime::now();
+
+    try
+    {
+      move_group = new moveit::planning_interface::MoveGroupInterface("gripper");
+    }
+    catch (const std::runtime_error &e)
+    {
+      ROS_ERROR("Failed to connect to move_group (gripper) : %s", e.what());
+      return;
+    }
+
+    is_move_group_ready_ = true;
+    ROS_INFO("MoveGroupInterface (gripper) is ready in %.3f sec", (ros::WallTime::now() - start_time).toSec());
+  });
+}
+
+void GripperController::initOnlineTrajectory()
+{
+  gripper_joint_names_.push_back("grip_joint");
+  gripper_joint_names_.push_back("grip_joint_sub");
+
+  urdf::Model urdf_model;
+  bool is_urdf_loaded = urdf_model.initParam("robot_description");
+
+  std::vector<MotionLimit> limit(palm_num_);
+
+  for (uint8_t index = 0; index < palm_num_; index++)
+  {
+    const std::string prefix = "robot_description_planning/joint_limits/" + gripper_joint_names_[index] + "/";
+
+    nh_.param<double>(prefix + "max_velocity",     limit[index].max_velocity,     0.1);
+    nh_.param<double>(prefix + "max_acceleration", limit[index].max_acceleration, 1.0);
+    nh_.param<double>(prefix + "max_jerk",         limit[index].max_jerk,         10.0);
+
+    urdf::JointConstSharedPtr joint;
+    if (is_urdf_loaded)
+      joint = urdf_model.getJoint(gripper_joint_names_[index]);
+
+    gripper_lower_limit_.push_back((joint && joint->limits) ? joint->limits->lower : GRIP_ON);
+    gripper_upper_limit_.push_back((joint && joint->limits) ? joint->limits->upper : GRIP_OFF);
+  }
+
+  present_gripper_position_.assign(palm_num_, 0.0);
+  online_trajectory_.init(limit, 1.0 / control_rate_);
+}
+
 void GripperController::initPublisher(bool using_gazebo)
 {
   if (using_gazebo)
   {
     ROS_INFO("SET Gazebo Simulation Mode(Gripper)");
 
-    if (robot_name_ == "open_manipulator")
+    const std::string prefix = (robot_name_ == "open_manipulator") ? robot_name_ + "/" : "/";
+
+    if (using_gazebo_group_command_)
     {
-      gazebo_gripper_position_pub_[LEFT_PALM]  = nh_.advertise<std_msgs::Float64>(robot_name_ + "/grip_joint_position/command", 10);
-      gazebo_gripper_position_pub_[RIGHT_PALM] = nh_.advertise<std_msgs::Float64>(robot_name_ + "/grip_joint_sub_position/command", 10);
+      // JointGroupPositionController over grip_joint and grip_joint_sub, see config/gazebo_controller.yaml
+      gazebo_gripper_position_pub_ = nh_.advertise<std_msgs::Float64MultiArray>(prefix + "gripper_position/command", 10);
+      gazebo_goal_gripper_position_.data.assign(palm_num_, 0.0);
     }
     else
     {
-      gazebo_gripper_position_pub_[LEFT_PALM]  = nh_.advertise<std_msgs::Float64>("/grip_joint_position/command", 10);
-      gazebo_gripper_position_pub_[RIGHT_PALM] = nh_.advertise<std_msgs::Float64>("/grip_joint_sub_position/command", 10);
+      gazebo_palm_position_pub_[LEFT_PALM]  = nh_.advertise<std_msgs::Float64>(prefix + "grip_joint_position/command", 10);
+      gazebo_palm_position_pub_[RIGHT_PALM] = nh_.advertise<std_msgs::Float64>(prefix + "grip_joint_sub_position/command", 10);
     }
   }
   else
   {
     gripper_position_pub_ = nh_.advertise<sensor_msgs::JointState>(robot_name_ + "/goal_gripper_position", 10);
+
+    goal_gripper_position_.position.assign(palm_num_, 0.0);
+    goal_gripper_position_.effort.reserve(palm_num_);
   }
 
-  gripper_state_pub_ = nh_.advertise<open_manipulator_msgs::State>(robot_name_ + "/gripper_state", 10);
+  grasp_state_pub_ = nh_.advertise<open_manipulator_position_ctrl::GraspState>(robot_name_ + "/grasp_state", 10, true);
 }
 
 void GripperController::initSubscriber(bool using_gazebo)
@@ -78,13 +177,14 @@ void GripperController::initSubscriber(bool using_gazebo)
   gripper_onoff_sub_ = nh_.subscribe(robot_name_ + "/gripper", 10,
                                      &GripperController::gripperOnOffMsgCallback, this);
 
-  display_planned_path_sub_ = nh_.subscribe("/move_group/display_planned_path", 100,
-                                            &GripperController::displayPlannedPathMsgCallback, this);
+  joint_states_sub_ = nh_.subscribe(robot_name_ + "/joint_states", 10,
+                                    &GripperController::jointStatesMsgCallback, this);
 }
 
 void GripperController::initServer()
 {
-  set_gripper_position_server_ = nh_.advertiseService(robot_name_ + "/set_gripper_position", &GripperController::setGripperPositionMsgCallback, this);
+  set_gripper_position_server_ = planning_nh_.advertiseService(robot_name_ + "/set_gripper_position", &GripperController::setGripperPositionMsgCallback, this);
+  set_gripper_position_online_server_ = nh_.advertiseService(robot_name_ + "/set_gripper_position_online", &GripperController::setGripperPositionOnlineMsgCallback, this);
 }
 
 bool GripperController::setGripperPositionMsgCallback(open_manipulator_msgs::SetJointPosition::Request &req,
@@ -95,10 +195,65 @@ bool GripperController::setGripperPositionMsgCallback(open_manipulator_msgs::Set
   return true;
 }
 
+bool GripperController::setGripperPositionOnlineMsgCallback(open_manipulator_msgs::SetJointPosition::Request &req,
+                                                            open_manipulator_msgs::SetJointPosition::Response &res)
+{
+  const open_manipulator_msgs::JointPosition &msg = req.joint_position;
+
+  if (msg.position.empty())
+  {
+    ROS_WARN("No target position, online trajectory is not started");
+    res.isPlanned = false;
+    return true;
+  }
+
+  const double velocity_scale     = (msg.max_velocity_scaling_factor > 0.0) ? msg.max_velocity_scaling_factor : 1.0;
+  const double acceleration_scale = (msg.max_accelerations_scaling_factor > 0.0) ? msg.max_accelerations_scaling_factor : 1.0;
+
+  res.isPlanned = startOnlineTrajectory(msg.position[0], velocity_scale, acceleration_scale, release_current_);
+
+  return true;
+}
+
+bool GripperController::startOnlineTrajectory(double position, double velocity_scale, double acceleration_scale, double goal_current)
+{
+  if (is_moving_)
+  {
+    ROS_WARN("ROBOT IS WORKING");
+    return false;
+  }
+
+  if (is_joint_states_received_ == false)
+  {
+    ROS_WARN("No joint states yet, online trajectory is not started");
+    return false;
+  }
+
+  // A running motion is retargeted from its present state, otherwise start at rest where the gripper is
+  if (is_online_moving_ == false)
+    online_trajectory_.reset(present_gripper_position_);
+
+  std::vector<double> target(palm_num_);
+
+  for (uint8_t index = 0; index < palm_num_; index++)
+    target[index] = std::max(gripper_lower_limit_[index], std::min(gripper_upper_limit_[index], position));
+
+  online_trajectory_.setTarget(target, velocity_scale, acceleration_scale);
+
+  goal_current_     = goal_current;
+  is_online_moving_ = true;
+  is_grasping_      = false;
+
+  return true;
+}
+
 bool GripperController::calcPlannedPath(open_manipulator_msgs::JointPosition msg)
 {
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
+  if (is_move_group_ready_ == false)
+  {
+    ROS_WARN("MoveIt! is not ready yet, planning is rejected");
+    return false;
+  }
 
   bool isPlanned = false;
 
@@ -125,7 +280,7 @@ bool GripperController::calcPlannedPath(open_manipulator_msgs::JointPosition msg
 
   moveit::planning_interface::MoveGroupInterface::Plan my_plan;
 
-  if (is_moving_ == false)
+  if (is_moving_ == false && is_online_moving_ == false)
   {
     bool success = (move_group->plan(my_plan) == moveit::planning_interface::MoveItErrorCode::SUCCESS);
 
@@ -145,32 +300,37 @@ bool GripperController::calcPlannedPath(open_manipulator_msgs::JointPosition msg
     isPlanned = false;
   }
 
-  spinner.stop();
-
   return isPlanned;
 }
 
-void GripperController::gripperOnOffMsgCallback(const std_msgs::String::ConstPtr &msg)
+bool GripperController::startGrasp(void)
 {
-  open_manipulator_msgs::JointPosition joint_msg;
+  if (startOnlineTrajectory(GRIP_ON, 1.0, 1.0, grip_current_) == false)
+    return false;
+
+  is_grasping_            = true;
+  grasp_result_           = "";
+  grasp_start_time_       = ros::Time::now();
+  grasp_stall_start_time_ = grasp_start_time_;
+  grasp_motion_end_time_  = grasp_start_time_;
 
-  joint_msg.max_velocity_scaling_factor = 5.0;
-  joint_msg.max_accelerations_scaling_factor = 2.0;
+  return true;
+}
 
+void GripperController::gripperOnOffMsgCallback(const std_msgs::String::ConstPtr &msg)
+{
+  // Presets are streamed from the next control cycle on, without a round trip through the planner
   if (msg->data == "grip_on")
   {
-    joint_msg.position.push_back(GRIP_ON);
-    calcPlannedPath(joint_msg);
+    startGrasp();
   }
   else if (msg->data == "grip_off")
   {
-    joint_msg.position.push_back(GRIP_OFF);
-    calcPlannedPath(joint_msg);
+    startOnlineTrajectory(GRIP_OFF, 1.0, 1.0, release_current_);
   }
-    else if (msg->data == "neutral")
+  else if (msg->data == "neutral")
   {
-    joint_msg.position.push_back(NEUTRAL);
-    calcPlannedPath(joint_msg);
+    startOnlineTrajectory(NEUTRAL, 1.0, 1.0, release_current_);
   }
   else
   {
@@ -183,97 +343,198 @@ void GripperController::displayPlannedPathMsgCallback(const moveit_msgs::Display
   // Can find 'grip'
   if (msg->trajectory[0].joint_trajectory.joint_names[0].find("grip") != std::string::npos)
   {
+    if (is_online_moving_)
+    {
+      ROS_WARN("ROBOT IS WORKING, planned path is ignored");
+      return;
+    }
+
     ROS_INFO("Get Gripper Planned Path");
-    uint8_t gripper_num = 2;
+    const std::vector<trajectory_msgs::JointTrajectoryPoint> &points = msg->trajectory[0].joint_trajectory.points;
 
-    planned_path_info_.waypoints = msg->trajectory[0].joint_trajectory.points.size();
+    if (points.empty() || points.size() > planned_path_.getCapacity())
+    {
+      ROS_WARN("Planned path has %d waypoints, it is ignored", (int)points.size());
+      return;
+    }
 
-    planned_path_info_.planned_path_positions.resize(planned_path_info_.waypoints, gripper_num);
+    planned_path_.clear();
 
-    for (uint16_t point_num = 0; point_num < planned_path_info_.waypoints; point_num++)
+    for (std::size_t point_num = 0; point_num < points.size(); point_num++)
     {
-      for (uint8_t num = 0; num < gripper_num; num++)
+      if (points[point_num].positions.size() < palm_num_)
+        return;
+
+      planned_path_.push(points[point_num].positions.data(),
+                         (points[point_num].velocities.size() >= palm_num_) ? points[point_num].velocities.data() : NULL,
+                         points[point_num].time_from_start.toSec());
+    }
+
+    all_time_steps_ = planned_path_.getSize() - 1;
+    step_cnt_       = 0;
+    path_step_time_ = 0.0;
+    goal_current_   = release_current_;
+    is_grasping_    = false;
+
+    is_moving_  = true;
+  }
+}
+
+void GripperController::jointStatesMsgCallback(const sensor_msgs::JointState::ConstPtr &msg)
+{
+  const double previous_position = present_gripper_position_[LEFT_PALM];
+  uint8_t found = 0;
+
+  for (std::size_t num = 0; num < msg->name.size() && num < msg->position.size(); num++)
+  {
+    for (uint8_t index = 0; index < palm_num_; index++)
+    {
+      if (msg->name[num] == gripper_joint_names_[index])
       {
-        float joint_position = msg->trajectory[0].joint_trajectory.points[point_num].positions[num];
+        present_gripper_position_[index] = msg->position[num];
+        found++;
 
-        planned_path_info_.planned_path_positions.coeffRef(point_num , num) = joint_position;
+        if (index == LEFT_PALM && num < msg->effort.size())
+          present_gripper_current_ = msg->effort[num];
       }
     }
+  }
 
-    all_time_steps_ = planned_path_info_.waypoints - 1;
+  if (found != palm_num_)
+    return;
 
-    ros::WallDuration sleep_time(0.5);
-    sleep_time.sleep();
+  // The driver does not report velocity, differentiate the position
+  const double dt = (msg->header.stamp - joint_states_stamp_).toSec();
+  if (is_joint_states_received_ && dt > 0.0)
+    present_gripper_velocity_ = (present_gripper_position_[LEFT_PALM] - previous_position) / dt;
 
-    is_moving_  = true; 
+  joint_states_stamp_       = msg->header.stamp;
+  is_joint_states_received_ = true;
+}
+
+void GripperController::processOnlineTrajectory(void)
+{
+  const bool is_moving = online_trajectory_.update();
+  const std::vector<MotionState> &state = online_trajectory_.getState();
+
+  publishGoalGripperPosition(state[LEFT_PALM].position, state[RIGHT_PALM].position);
+
+  if (is_moving == false)
+  {
+    is_online_moving_ = false;
+
+    ROS_INFO("Complete Execution");
   }
 }
 
-void GripperController::process(void)
+void GripperController::processGraspDetection(void)
 {
-  static uint16_t step_cnt = 0;
-  std_msgs::Float64 gazebo_goal_gripper_position;
-  sensor_msgs::JointState goal_gripper_position;
-  open_manipulator_msgs::State state;
+  const ros::Time now = ros::Time::now();
 
-  if (is_moving_)
+  if (std::fabs(present_gripper_current_) < grasp_current_threshold_ ||
+      std::fabs(present_gripper_velocity_) > grasp_stall_velocity_)
+    grasp_stall_start_time_ = now;
+
+  if ((now - grasp_stall_start_time_).toSec() >= grasp_stall_time_)
   {
-    if (using_gazebo_)
+    // Hand the closing endpoint to the servo so it keeps squeezing at the goal current
+    if (is_online_moving_)
     {
-      gazebo_goal_gripper_position.data = planned_path_info_.planned_path_positions(step_cnt, 0);
-      gazebo_gripper_position_pub_[LEFT_PALM].publish(gazebo_goal_gripper_position);
+      const std::vector<double> &target = online_trajectory_.getTarget();
 
-      gazebo_goal_gripper_position.data = planned_path_info_.planned_path_positions(step_cnt, 1);
-      gazebo_gripper_position_pub_[RIGHT_PALM].publish(gazebo_goal_gripper_position);
-
-      step_cnt++;
+      publishGoalGripperPosition(target[LEFT_PALM], target[RIGHT_PALM]);
+      is_online_moving_ = false;
     }
-    else
-    {
-      goal_gripper_position.position.push_back(planned_path_info_.planned_path_positions(step_cnt, 0));
-      goal_gripper_position.position.push_back(planned_path_info_.planned_path_positions(step_cnt, 1));
 
-      gripper_position_pub_.publish(goal_gripper_position);
+    publishGraspState(open_manipulator_position_ctrl::GraspState::GRASPED);
+    return;
+  }
 
-      step_cnt++;
-    }
+  if (is_online_moving_)
+    grasp_motion_end_time_ = now;
+  else if ((now - grasp_motion_end_time_).toSec() >= grasp_settle_time_)
+    publishGraspState(open_manipulator_position_ctrl::GraspState::EMPTY);
+}
 
-    if (step_cnt >= all_time_steps_)
-    {
-      is_moving_ = false;
-      step_cnt   = 0;
+void GripperController::publishGraspState(const std::string &result)
+{
+  open_manipulator_position_ctrl::GraspState grasp_state;
 
-      ROS_INFO("Complete Execution");
-    }
+  grasp_state.header.stamp = ros::Time::now();
+  grasp_state.result       = result;
+  grasp_state.start_time   = grasp_start_time_;
+  grasp_state.position     = present_gripper_position_[LEFT_PALM];
+  grasp_state.current      = present_gripper_current_;
+
+  grasp_state_pub_.publish(grasp_state);
+
+  ROS_INFO("Grip %s in %.3f sec", result.c_str(), (grasp_state.header.stamp - grasp_start_time_).toSec());
+
+  grasp_result_ = result;
+  is_grasping_  = false;
+}
 
-    state.robot = state.IS_MOVING;
-    gripper_state_pub_.publish(state);
+void GripperController::publishGoalGripperPosition(double left_position, double right_position)
+{
+  if (using_gazebo_ && using_gazebo_group_command_)
+  {
+    gazebo_goal_gripper_position_.data[LEFT_PALM]  = left_position;
+    gazebo_goal_gripper_position_.data[RIGHT_PALM] = right_position;
+
+    gazebo_gripper_position_pub_.publish(gazebo_goal_gripper_position_);
+  }
+  else if (using_gazebo_)
+  {
+    gazebo_palm_position_.data = left_position;
+    gazebo_palm_position_pub_[LEFT_PALM].publish(gazebo_palm_position_);
+
+    gazebo_palm_position_.data = right_position;
+    gazebo_palm_position_pub_[RIGHT_PALM].publish(gazebo_palm_position_);
   }
   else
   {
-    state.robot = state.STOPPED;
-    gripper_state_pub_.publish(state);
+    goal_gripper_position_.position[LEFT_PALM]  = left_position;
+    goal_gripper_position_.position[RIGHT_PALM] = right_position;
+
+    // Within the reserved capacity, no allocation
+    goal_gripper_position_.effort.assign((goal_current_ > 0.0) ? palm_num_ : 0, goal_current_);
+
+    gripper_position_pub_.publish(goal_gripper_position_);
   }
 }
 
-int main(int argc, char **argv)
+void GripperController::processPlannedPath(void)
 {
-  ros::init(argc, argv, "gripper_controller_for_OpenManipulator");
+  // Waypoints are sampled for ITERATION_FREQUENCY, hold each one for as many control cycles as needed
+  if (path_step_time_ <= 1e-9)
+  {
+    const double *position = planned_path_.getPosition(step_cnt_);
 
-  ros::WallDuration sleep_time(3.0);
-  sleep_time.sleep();
+    publishGoalGripperPosition(position[LEFT_PALM], position[RIGHT_PALM]);
+    step_cnt_++;
 
-  GripperController controller;
+    path_step_time_ += 1.0 / ITERATION_FREQUENCY;
+  }
 
-  ros::Rate loop_rate(ITERATION_FREQUENCY);
+  path_step_time_ -= 1.0 / control_rate_;
 
-  while (ros::ok())
+  if (step_cnt_ >= all_time_steps_)
   {
-    controller.process();
+    is_moving_      = false;
+    step_cnt_       = 0;
+    path_step_time_ = 0.0;
 
-    ros::spinOnce();
-    loop_rate.sleep();
+    ROS_INFO("Complete Execution");
   }
+}
+
+void GripperController::process(void)
+{
+  if (is_moving_)
+    processPlannedPath();
+  else if (is_online_moving_)
+    processOnlineTrajectory();
 
-  return 0;
+  if (is_grasping_)
+    processGraspDetection();
 }
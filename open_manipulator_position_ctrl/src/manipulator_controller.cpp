@@ -0,0 +1,408 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_position_ctrl/manipulator_controller.h"
+
+using namespace open_manipulator;
+
+static const char *task_phase_name[] = {"", "PLANNING", "APPROACH", "DESCEND", "GRASP", "RELEASE", "RETREAT"};
+
+ManipulatorController::ManipulatorController()
+    :priv_nh_("~"),
+     robot_name_(""),
+     control_rate_(CONTROL_FREQUENCY),
+     init_position_(false),
+     startup_timeout_(30.0),
+     arm_controller_(NULL),
+     gripper_controller_(NULL),
+     startup_time_(ros::WallTime::now()),
+     robot_description_time_(-1.0),
+     joint_states_time_(-1.0),
+     move_group_time_(-1.0),
+     is_ready_(false),
+     is_startup_timed_out_(false),
+     task_phase_(TASK_IDLE)
+{
+  // Init parameter
+  nh_.getParam("robot_name", robot_name_);
+  priv_nh_.getParam("control_rate", control_rate_);
+  priv_nh_.getParam("init_position", init_position_);
+  priv_nh_.getParam("startup_timeout", startup_timeout_);
+
+  // Nothing is published until the first change
+  manipulator_state_.arm     = "";
+  manipulator_state_.gripper = "";
+  manipulator_state_.task    = "";
+}
+
+ManipulatorController::~ManipulatorController()
+{
+  // Planning runs on the arm controller, let it finish first
+  if (task_plan_.valid())
+    task_plan_.wait();
+
+  // The gripper services run on the planning queue of the arm
+  delete gripper_controller_;
+  delete arm_controller_;
+}
+
+bool ManipulatorController::init(void)
+{
+  // Local kinematics and joint limits are read from the robot description while the controllers are built
+  if (waitForRobotDescription() == false)
+    return false;
+
+  arm_controller_     = new ArmController();
+  gripper_controller_ = new GripperController(arm_controller_->getPlanningQueue());
+
+  initPublisher();
+  initSubscriber();
+  initServer();
+
+  return true;
+}
+
+bool ManipulatorController::waitForRobotDescription(void)
+{
+  ros::WallRate rate(100);
+
+  while (ros::ok())
+  {
+    const double elapsed_time = (ros::WallTime::now() - startup_time_).toSec();
+
+    if (nh_.hasParam("robot_description"))
+    {
+      robot_description_time_ = elapsed_time;
+      return true;
+    }
+
+    if (elapsed_time > startup_timeout_)
+    {
+      ROS_ERROR("robot_description is not loaded after %.1f sec", startup_timeout_);
+      return false;
+    }
+
+    rate.sleep();
+  }
+
+  return false;
+}
+
+void ManipulatorController::checkReadiness(void)
+{
+  const double elapsed_time = (ros::WallTime::now() - startup_time_).toSec();
+
+  if (move_group_time_ < 0.0 && arm_controller_->isMoveGroupReady() && gripper_controller_->isMoveGroupReady())
+    move_group_time_ = elapsed_time;
+
+  if (joint_states_time_ >= 0.0 && move_group_time_ >= 0.0)
+  {
+    ROS_INFO("Manipulator controller is ready in %.3f sec (robot_description %.3f, joint_states %.3f, move_group %.3f)",
+             elapsed_time, robot_description_time_, joint_states_time_, move_group_time_);
+    is_ready_ = true;
+
+    if (init_position_ == true)
+      arm_controller_->initJointPosition();
+  }
+  else if (is_startup_timed_out_ == false && elapsed_time > startup_timeout_)
+  {
+    // Keep going, the dependencies may still show up late
+    ROS_ERROR("Still waiting for%s%s after %.1f sec",
+              (joint_states_time_ < 0.0) ? " joint_states" : "",
+              (move_group_time_ < 0.0) ? " move_group" : "",
+              startup_timeout_);
+    is_startup_timed_out_ = true;
+  }
+}
+
+void ManipulatorController::initPublisher()
+{
+  manipulator_state_pub_ = nh_.advertise<open_manipulator_position_ctrl::ManipulatorState>(robot_name_ + "/manipulator_state", 10);
+
+  arm_state_pub_     = nh_.advertise<open_manipulator_msgs::State>(robot_name_ + "/arm_state", 10, true);
+  gripper_state_pub_ = nh_.advertise<open_manipulator_msgs::State>(robot_name_ + "/gripper_state", 10, true);
+}
+
+void ManipulatorController::initSubscriber()
+{
+  display_planned_path_sub_ = nh_.subscribe("/move_group/display_planned_path", 100,
+                                            &ManipulatorController::displayPlannedPathMsgCallback, this);
+
+  joint_states_sub_ = nh_.subscribe(robot_name_ + "/joint_states", 1, &ManipulatorController::jointStatesMsgCallback, this);
+}
+
+void ManipulatorController::initServer()
+{
+  pick_place_server_ = nh_.advertiseService(robot_name_ + "/pick_place", &ManipulatorController::pickPlaceMsgCallback, this);
+}
+
+bool ManipulatorController::pickPlaceMsgCallback(open_manipulator_position_ctrl::PickPlace::Request &req,
+                                                 open_manipulator_position_ctrl::PickPlace::Response &res)
+{
+  res.isPlanned = false;
+
+  if (req.task != req.PICK && req.task != req.PLACE)
+  {
+    ROS_WARN("Task must be PICK or PLACE, not '%s'", req.task.c_str());
+    return true;
+  }
+
+  if (is_ready_ == false)
+  {
+    ROS_WARN("Manipulator controller is not ready yet");
+    return true;
+  }
+
+  if (task_phase_ != TASK_IDLE || arm_controller_->isMoving() || gripper_controller_->isMoving())
+  {
+    ROS_WARN("ROBOT IS WORKING");
+    return true;
+  }
+
+  task_ = req;
+  task_start_time_ = ros::WallTime::now();
+  arm_controller_->setTaskMode(true);
+
+  // Pre-shape the gripper while the arm paths are planned and the approach runs
+  if (task_.task == task_.PICK)
+    gripper_controller_->moveGripper(task_.gripper_position);
+
+  task_plan_ = std::async(std::launch::async, &ManipulatorController::planTask, this);
+  setTaskPhase(TASK_PLANNING);
+
+  res.isPlanned = true;
+  return true;
+}
+
+bool ManipulatorController::planTask(void)
+{
+  // Each path starts where the previous one ends, so the retreat is ready before the grasp is detected
+  const geometry_msgs::Pose *target_pose[TASK_PATH_NUM] = {&task_.approach_pose, &task_.grasp_pose, &task_.retreat_pose};
+  std::vector<double> start_position;
+
+  for (uint8_t path = 0; path < TASK_PATH_NUM; path++)
+  {
+    if (arm_controller_->planPath(*target_pose[path], start_position,
+                                  task_.max_velocity_scaling_factor, task_.max_accelerations_scaling_factor,
+                                  task_path_[path]) == false)
+      return false;
+
+    start_position = task_path_[path].points.back().positions;
+  }
+
+  return true;
+}
+
+void ManipulatorController::setTaskPhase(TaskPhase phase)
+{
+  task_phase_ = phase;
+  manipulator_state_.task = task_phase_name[phase];
+
+  if (phase != TASK_IDLE)
+    ROS_INFO("%s %s (%.3f sec)", task_.task.c_str(), task_phase_name[phase], (ros::WallTime::now() - task_start_time_).toSec());
+}
+
+void ManipulatorController::finishTask(const std::string &result)
+{
+  ROS_INFO("%s %s in %.3f sec", task_.task.c_str(), result.c_str(), (ros::WallTime::now() - task_start_time_).toSec());
+
+  manipulator_state_.task_result = result;
+  arm_controller_->setTaskMode(false);
+  setTaskPhase(TASK_IDLE);
+}
+
+void ManipulatorController::processTask(void)
+{
+  switch (task_phase_)
+  {
+    case TASK_PLANNING:
+      if (task_plan_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        break;
+
+      if (task_plan_.get() == false)
+      {
+        finishTask("FAILED");
+        break;
+      }
+
+      if (arm_controller_->startPath(task_path_[APPROACH_PATH]) == false)
+      {
+        finishTask("FAILED");
+        break;
+      }
+
+      setTaskPhase(TASK_APPROACH);
+      break;
+
+    case TASK_APPROACH:
+      if (arm_controller_->isMoving() || gripper_controller_->isMoving())
+        break;
+
+      // The next path starts where this one ends, it must not be played from anywhere else
+      if (arm_controller_->getPathResult() != PATH_COMPLETED ||
+          arm_controller_->startPath(task_path_[GRASP_PATH]) == false)
+      {
+        finishTask("FAILED");
+        break;
+      }
+
+      setTaskPhase(TASK_DESCEND);
+      break;
+
+    case TASK_DESCEND:
+      if (arm_controller_->isMoving())
+        break;
+
+      if (arm_controller_->getPathResult() != PATH_COMPLETED)
+      {
+        finishTask("FAILED");
+        break;
+      }
+
+      if (task_.task == task_.PICK)
+      {
+        gripper_controller_->startGrasp();
+        setTaskPhase(TASK_GRASP);
+      }
+      else
+      {
+        gripper_controller_->moveGripper(task_.gripper_position);
+        setTaskPhase(TASK_RELEASE);
+      }
+      break;
+
+    case TASK_GRASP:
+      if (gripper_controller_->isGrasping())
+        break;
+
+      if (arm_controller_->startPath(task_path_[RETREAT_PATH]) == false)
+      {
+        finishTask("FAILED");
+        break;
+      }
+
+      setTaskPhase(TASK_RETREAT);
+      break;
+
+    case TASK_RELEASE:
+      if (gripper_controller_->isMoving())
+        break;
+
+      if (arm_controller_->startPath(task_path_[RETREAT_PATH]) == false)
+      {
+        finishTask("FAILED");
+        break;
+      }
+
+      setTaskPhase(TASK_RETREAT);
+      break;
+
+    case TASK_RETREAT:
+      if (arm_controller_->isMoving())
+        break;
+
+      if (arm_controller_->getPathResult() != PATH_COMPLETED)
+        finishTask("FAILED");
+      else if (task_.task == task_.PICK && gripper_controller_->getGraspResult() != open_manipulator_position_ctrl::GraspState::GRASPED)
+        finishTask("EMPTY");
+      else
+        finishTask("SUCCEEDED");
+      break;
+
+    default:
+      break;
+  }
+}
+
+void ManipulatorController::displayPlannedPathMsgCallback(const moveit_msgs::DisplayTrajectory::ConstPtr &msg)
+{
+  if (msg->trajectory.empty() || msg->trajectory[0].joint_trajectory.joint_names.empty())
+    return;
+
+  // Can't find 'grip'
+  if (msg->trajectory[0].joint_trajectory.joint_names[0].find("grip") == std::string::npos)
+    arm_controller_->displayPlannedPathMsgCallback(msg);
+  else
+    gripper_controller_->displayPlannedPathMsgCallback(msg);
+}
+
+void ManipulatorController::jointStatesMsgCallback(const sensor_msgs::JointState::ConstPtr &msg)
+{
+  // Only the arrival of the first message is of interest
+  joint_states_time_ = (ros::WallTime::now() - startup_time_).toSec();
+  joint_states_sub_.shutdown();
+}
+
+void ManipulatorController::publishState(bool is_arm_moving, bool is_gripper_moving)
+{
+  const std::string arm_state     = is_arm_moving ? manipulator_state_.IS_MOVING : manipulator_state_.STOPPED;
+  const std::string gripper_state = is_gripper_moving ? manipulator_state_.IS_MOVING : manipulator_state_.STOPPED;
+
+  if (arm_state != manipulator_state_.arm)
+  {
+    open_manipulator_msgs::State state;
+    state.robot = is_arm_moving ? state.IS_MOVING : state.STOPPED;
+    arm_state_pub_.publish(state);
+  }
+
+  if (gripper_state != manipulator_state_.gripper)
+  {
+    open_manipulator_msgs::State state;
+    state.robot = is_gripper_moving ? state.IS_MOVING : state.STOPPED;
+    gripper_state_pub_.publish(state);
+  }
+
+  manipulator_state_.header.stamp = ros::Time::now();
+  manipulator_state_.arm          = arm_state;
+  manipulator_state_.gripper      = gripper_state;
+
+  manipulator_state_pub_.publish(manipulator_state_);
+}
+
+void ManipulatorController::process(void)
+{
+  arm_controller_->process();
+  gripper_controller_->process();
+
+  if (is_ready_ == false)
+    checkReadiness();
+  else if (task_phase_ != TASK_IDLE)
+    processTask();
+
+  publishState(arm_controller_->isMoving(), gripper_controller_->isMoving());
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "manipulator_controller_for_OpenManipulator");
+
+  ManipulatorController controller;
+
+  if (controller.init() == false)
+    return 1;
+
+  ros::Rate loop_rate(controller.getControlRate());
+
+  while (ros::ok())
+  {
+    controller.process();
+
+    ros::spinOnce();
+    loop_rate.sleep();
+  }
+
+  return 0;
+}
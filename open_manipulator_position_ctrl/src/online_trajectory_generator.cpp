@@ -0,0 +1,233 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_position_ctrl/online_trajectory_generator.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace open_manipulator;
+
+static const int    JERK_BISECTION_ITERATIONS = 30;
+static const double POSITION_TOLERANCE        = 1e-6;
+static const double VELOCITY_TOLERANCE        = 1e-4;
+static const double ACCELERATION_TOLERANCE    = 1e-3;
+
+static MotionState integrate(const MotionState &state, double jerk, double time)
+{
+  MotionState next;
+
+  next.position     = state.position + state.velocity * time + state.acceleration * time * time / 2.0 + jerk * time * time * time / 6.0;
+  next.velocity     = state.velocity + state.acceleration * time + jerk * time * time / 2.0;
+  next.acceleration = state.acceleration + jerk * time;
+
+  return next;
+}
+
+// Position where the joint comes to rest when braking as hard as the limits allow
+static double calcRestPosition(const MotionState &state, const MotionLimit &limit)
+{
+  const double jerk = limit.max_jerk;
+
+  // Braking direction follows the velocity left once the acceleration is ramped to zero
+  const double sign = (state.velocity + state.acceleration * std::fabs(state.acceleration) / (2.0 * jerk) >= 0.0) ? 1.0 : -1.0;
+
+  const double velocity     = sign * state.velocity;
+  const double acceleration = sign * state.acceleration;
+
+  // Peak deceleration of a triangular acceleration profile, then clipped to the limit
+  double peak = -std::sqrt(std::max(0.0, jerk * velocity + acceleration * acceleration / 2.0));
+  double hold_time = 0.0;
+
+  if (peak < -limit.max_acceleration)
+  {
+    peak = -limit.max_acceleration;
+    hold_time = (velocity + (acceleration * acceleration - 2.0 * peak * peak) / (2.0 * jerk)) / limit.max_acceleration;
+    hold_time = std::max(0.0, hold_time);
+  }
+
+  MotionState brake = {0.0, velocity, acceleration};
+  brake = integrate(brake, -jerk, std::max(0.0, (acceleration - peak) / jerk));
+  brake = integrate(brake, 0.0, hold_time);
+  brake = integrate(brake, jerk, -peak / jerk);
+
+  return state.position + sign * brake.position;
+}
+
+OnlineTrajectoryGenerator::OnlineTrajectoryGenerator()
+    :period_(0.01),
+     duration_(0.0),
+     is_finished_(true)
+{
+}
+
+void OnlineTrajectoryGenerator::init(const std::vector<MotionLimit> &limit, double period)
+{
+  limit_      = limit;
+  sync_limit_ = limit;
+  period_     = period;
+
+  std::vector<double> position(limit.size(), 0.0);
+  reset(position);
+}
+
+void OnlineTrajectoryGenerator::reset(const std::vector<double> &position)
+{
+  state_.resize(position.size());
+  target_ = position;
+
+  for (std::size_t index = 0; index < position.size(); index++)
+  {
+    state_[index].position     = position[index];
+    state_[index].velocity     = 0.0;
+    state_[index].acceleration = 0.0;
+  }
+
+  duration_    = 0.0;
+  is_finished_ = true;
+}
+
+double OnlineTrajectoryGenerator::calcDuration(double distance, const MotionLimit &limit)
+{
+  const double V = limit.max_velocity;
+  const double A = limit.max_acceleration;
+  const double J = limit.max_jerk;
+
+  distance = std::fabs(distance);
+
+  // Time to reach velocity v from rest and the distance covered accelerating and braking symmetrically
+  double accel_time = (V * J >= A * A) ? V / A + A / J : 2.0 * std::sqrt(V / J);
+
+  if (distance >= V * accel_time)
+    return 2.0 * accel_time + (distance - V * accel_time) / V;
+
+  // Maximum velocity is not reached
+  double peak = std::pow(distance * std::sqrt(J) / 2.0, 2.0 / 3.0);
+
+  if (peak <= A * A / J)
+  {
+    accel_time = 2.0 * std::sqrt(peak / J);
+  }
+  else
+  {
+    peak = A / 2.0 * (-A / J + std::sqrt(A * A / (J * J) + 4.0 * distance / A));
+    accel_time = peak / A + A / J;
+  }
+
+  return 2.0 * accel_time;
+}
+
+void OnlineTrajectoryGenerator::setTarget(const std::vector<double> &target, double velocity_scale, double acceleration_scale)
+{
+  velocity_scale     = std::min(1.0, std::max(1e-3, velocity_scale));
+  acceleration_scale = std::min(1.0, std::max(1e-3, acceleration_scale));
+
+  target_ = target;
+  duration_ = 0.0;
+
+  for (std::size_t index = 0; index < limit_.size(); index++)
+  {
+    sync_limit_[index].max_velocity     = limit_[index].max_velocity * velocity_scale;
+    sync_limit_[index].max_acceleration = limit_[index].max_acceleration * acceleration_scale;
+    sync_limit_[index].max_jerk         = limit_[index].max_jerk;
+
+    duration_ = std::max(duration_, calcDuration(target_[index] - state_[index].position, sync_limit_[index]));
+  }
+
+  // Slowing a profile down in time by 1/k scales velocity by k, acceleration by k^2 and jerk by k^3.
+  // Joints that are still moving keep their limits so that they can always brake.
+  for (std::size_t index = 0; index < limit_.size() && duration_ > 0.0; index++)
+  {
+    if (std::fabs(state_[index].velocity) > VELOCITY_TOLERANCE || std::fabs(state_[index].acceleration) > ACCELERATION_TOLERANCE)
+      continue;
+
+    const double duration = calcDuration(target_[index] - state_[index].position, sync_limit_[index]);
+    const double k = std::max(1e-3, duration / duration_);
+
+    sync_limit_[index].max_velocity     *= k;
+    sync_limit_[index].max_acceleration *= k * k;
+    sync_limit_[index].max_jerk         *= k * k * k;
+  }
+
+  is_finished_ = false;
+}
+
+double OnlineTrajectoryGenerator::calcJerk(const MotionState &state, double target, const MotionLimit &limit) const
+{
+  // Work in the frame where the target lies ahead of the rest position
+  const double sign = (target >= calcRestPosition(state, limit)) ? 1.0 : -1.0;
+
+  MotionState present = {sign * state.position, sign * state.velocity, sign * state.acceleration};
+  const double goal = sign * target;
+
+  // Jerk that keeps the acceleration within its limit, or brings it back when a new target lowered it
+  double lower = -limit.max_jerk;
+  double upper =  limit.max_jerk;
+
+  lower = std::max(lower, std::min(upper, (-limit.max_acceleration - present.acceleration) / period_));
+  upper = std::min(upper, std::max(lower, ( limit.max_acceleration - present.acceleration) / period_));
+
+  // Largest jerk after which the joint can still stop on the target within the limits
+  for (int iteration = 0; iteration < JERK_BISECTION_ITERATIONS; iteration++)
+  {
+    const double jerk = (lower + upper) / 2.0;
+    const MotionState next = integrate(present, jerk, period_);
+
+    const double peak_velocity = next.velocity + std::max(0.0, next.acceleration) * next.acceleration / (2.0 * limit.max_jerk);
+
+    const bool feasible = peak_velocity <= limit.max_velocity &&
+                          calcRestPosition(next, limit) <= goal;
+
+    if (feasible)
+      lower = jerk;
+    else
+      upper = jerk;
+  }
+
+  return sign * lower;
+}
+
+bool OnlineTrajectoryGenerator::update()
+{
+  if (is_finished_)
+    return false;
+
+  bool is_moving = false;
+
+  for (std::size_t index = 0; index < state_.size(); index++)
+  {
+    MotionState &state = state_[index];
+
+    // Near rest the bang-bang jerk ends up alternating; settle once one jerk step can zero the acceleration
+    const double acceleration_tolerance = std::max(ACCELERATION_TOLERANCE, sync_limit_[index].max_jerk * period_);
+
+    if (std::fabs(target_[index] - state.position) < POSITION_TOLERANCE &&
+        std::fabs(state.velocity) < VELOCITY_TOLERANCE &&
+        std::fabs(state.acceleration) <= acceleration_tolerance)
+    {
+      state.position     = target_[index];
+      state.velocity     = 0.0;
+      state.acceleration = 0.0;
+      continue;
+    }
+
+    state = integrate(state, calcJerk(state, target_[index], sync_limit_[index]), period_);
+    is_moving = true;
+  }
+
+  is_finished_ = !is_moving;
+  return is_moving;
+}
@@ -0,0 +1,135 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Smooths a stream of joint setpoints (sensor_msgs/JointState positions) with the causal
+// StreamingSmoothingFilter and republishes them, one output per input message.
+//
+// Topics: input (subscribed), output (published), remap them in the launch file.
+//
+// ROS parameters (private):
+// - rate (default = 40 Hz, the rate of the input stream)
+// - type (default = low_pass, or fir, none)
+// - cutoff_frequency (default = 5.0 Hz, low_pass)
+// - coefficients (FIR taps, newest sample first)
+// - reset_timeout (default = 0.5 sec, a longer gap restarts the filter at the next setpoint)
+
+#include <ros/ros.h>
+#include <sensor_msgs/JointState.h>
+
+#include "open_manipulator_position_ctrl/streaming_smoothing_filter.h"
+
+#include <string>
+#include <vector>
+
+using namespace open_manipulator;
+
+class SetpointSmoothing
+{
+ private:
+  ros::NodeHandle nh_;
+  ros::NodeHandle priv_nh_;
+
+  ros::Subscriber setpoint_sub_;
+  ros::Publisher smoothed_setpoint_pub_;
+
+  SmoothingParam param_;
+  double period_;
+  double reset_timeout_;
+
+  StreamingSmoothingFilter filter_;
+  sensor_msgs::JointState smoothed_setpoint_;
+  ros::Time last_setpoint_time_;
+  bool is_initialized_;
+
+ public:
+  SetpointSmoothing()
+      :priv_nh_("~"),
+       period_(1.0 / 40.0),
+       reset_timeout_(0.5),
+       is_initialized_(false)
+  {
+  }
+
+  bool init()
+  {
+    double rate;
+    std::string type;
+
+    priv_nh_.param<double>("rate", rate, 40.0);
+    priv_nh_.param<std::string>("type", type, "low_pass");
+    priv_nh_.param<double>("cutoff_frequency", param_.cutoff_frequency, 5.0);
+    priv_nh_.param<double>("reset_timeout", reset_timeout_, 0.5);
+    priv_nh_.getParam("coefficients", param_.coefficients);
+
+    if (rate <= 0.0 || !StreamingSmoothingFilter::getType(type, param_.type))
+    {
+      ROS_ERROR("Setpoint smoothing needs a positive rate and a type of none, fir or low_pass");
+      return false;
+    }
+    period_ = 1.0 / rate;
+
+    // Checked once here, the filter itself is allocated for the joints of the first setpoint
+    StreamingSmoothingFilter check;
+    if (!check.init(param_, 1, period_))
+    {
+      ROS_ERROR("Invalid setpoint smoothing parameters (cutoff below %.1f Hz, FIR taps with a positive sum)", 0.5 * rate);
+      return false;
+    }
+
+    ROS_INFO("Setpoint smoothing : %s at %.1f Hz, group delay %.1f ms", type.c_str(), rate, check.getGroupDelay() * 1000.0);
+
+    smoothed_setpoint_pub_ = nh_.advertise<sensor_msgs::JointState>("output", 10);
+    setpoint_sub_ = nh_.subscribe("input", 10, &SetpointSmoothing::setpointMsgCallback, this,
+                                  ros::TransportHints().tcpNoDelay());
+    return true;
+  }
+
+ private:
+  void setpointMsgCallback(const sensor_msgs::JointState::ConstPtr &msg)
+  {
+    const ros::Time now = ros::Time::now();
+
+    // A new joint set or a pause of the stream starts over from the present setpoint
+    if (!is_initialized_ || msg->position.size() != smoothed_setpoint_.position.size() ||
+        (now - last_setpoint_time_).toSec() > reset_timeout_)
+    {
+      filter_.init(param_, msg->position.size(), period_);
+      filter_.reset(msg->position.data());
+
+      smoothed_setpoint_.position.resize(msg->position.size());
+      is_initialized_ = true;
+    }
+    last_setpoint_time_ = now;
+
+    filter_.update(msg->position.data(), smoothed_setpoint_.position.data());
+
+    smoothed_setpoint_.header = msg->header;
+    smoothed_setpoint_.name = msg->name;
+    smoothed_setpoint_pub_.publish(smoothed_setpoint_);
+  }
+};
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "setpoint_smoothing");
+
+  SetpointSmoothing setpoint_smoothing;
+  if (!setpoint_smoothing.init())
+    return 1;
+
+  ros::spin();
+  return 0;
+}
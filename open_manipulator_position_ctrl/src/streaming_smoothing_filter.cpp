@@ -0,0 +1,167 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_position_ctrl/streaming_smoothing_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace open_manipulator;
+
+StreamingSmoothingFilter::StreamingSmoothingFilter()
+    :type_(SMOOTHING_NONE),
+     joint_num_(0),
+     period_(0.0),
+     num_coef_(0),
+     newest_(0),
+     b0_(1.0), b1_(0.0), b2_(0.0), a1_(0.0), a2_(0.0),
+     group_delay_(0.0)
+{
+}
+
+bool StreamingSmoothingFilter::init(const SmoothingParam &param, std::size_t joint_num, double period)
+{
+  type_        = SMOOTHING_NONE;
+  joint_num_   = joint_num;
+  period_      = period;
+  group_delay_ = 0.0;
+
+  if (period <= 0.0)
+    return false;
+
+  if (param.type == SMOOTHING_FIR)
+  {
+    double gain = 0.0, moment = 0.0;
+    for (std::size_t index = 0; index < param.coefficients.size(); index++)
+    {
+      gain   += param.coefficients[index];
+      moment += index * param.coefficients[index];
+    }
+
+    if (param.coefficients.empty() || gain <= 0.0)
+      return false;
+
+    num_coef_ = param.coefficients.size();
+    coefficients_.resize(num_coef_);
+    for (std::size_t index = 0; index < num_coef_; index++)
+      coefficients_[index] = param.coefficients[index] / gain;
+
+    history_.assign(num_coef_ * joint_num_, 0.0);
+    newest_ = 0;
+
+    // Centroid of the taps, (num_coef - 1) / 2 samples for symmetric ones
+    group_delay_ = moment / gain * period_;
+  }
+  else if (param.type == SMOOTHING_LOW_PASS)
+  {
+    // Bilinear transform with the cutoff prewarped, which has to stay below Nyquist
+    if (param.cutoff_frequency <= 0.0 || param.cutoff_frequency >= 0.5 / period_)
+      return false;
+
+    const double k = std::tan(M_PI * param.cutoff_frequency * period_);
+    const double norm = 1.0 / (1.0 + M_SQRT2 * k + k * k);
+
+    b0_ = k * k * norm;
+    b1_ = 2.0 * b0_;
+    b2_ = b0_;
+    a1_ = 2.0 * (k * k - 1.0) * norm;
+    a2_ = (1.0 - M_SQRT2 * k + k * k) * norm;
+
+    state1_.assign(joint_num_, 0.0);
+    state2_.assign(joint_num_, 0.0);
+
+    // Delay of the numerator centroid (one sample) less the one of the denominator
+    group_delay_ = (1.0 - (a1_ + 2.0 * a2_) / (1.0 + a1_ + a2_)) * period_;
+  }
+  else if (param.type != SMOOTHING_NONE)
+  {
+    return false;
+  }
+
+  type_ = param.type;
+  return true;
+}
+
+void StreamingSmoothingFilter::reset(const double *position)
+{
+  if (type_ == SMOOTHING_FIR)
+  {
+    for (std::size_t sample = 0; sample < num_coef_; sample++)
+      std::copy(position, position + joint_num_, history_.begin() + sample * joint_num_);
+  }
+  else if (type_ == SMOOTHING_LOW_PASS)
+  {
+    // Steady state of the biquad memory for a constant input
+    for (std::size_t joint = 0; joint < joint_num_; joint++)
+    {
+      state1_[joint] = (1.0 - b0_) * position[joint];
+      state2_[joint] = (b2_ - a2_) * position[joint];
+    }
+  }
+}
+
+void StreamingSmoothingFilter::update(const double *input, double *output)
+{
+  if (type_ == SMOOTHING_FIR)
+  {
+    newest_ = (newest_ + num_coef_ - 1) % num_coef_;
+    std::copy(input, input + joint_num_, history_.begin() + newest_ * joint_num_);
+
+    // Coefficient k weights the sample k cycles old, in ring order
+    for (std::size_t joint = 0; joint < joint_num_; joint++)
+    {
+      double sum = 0.0;
+      std::size_t sample = newest_;
+
+      for (std::size_t index = 0; index < num_coef_; index++)
+      {
+        sum += coefficients_[index] * history_[sample * joint_num_ + joint];
+        sample = (sample + 1 == num_coef_) ? 0 : sample + 1;
+      }
+      output[joint] = sum;
+    }
+  }
+  else if (type_ == SMOOTHING_LOW_PASS)
+  {
+    for (std::size_t joint = 0; joint < joint_num_; joint++)
+    {
+      const double x = input[joint];
+      const double y = b0_ * x + state1_[joint];
+
+      state1_[joint] = b1_ * x - a1_ * y + state2_[joint];
+      state2_[joint] = b2_ * x - a2_ * y;
+      output[joint] = y;
+    }
+  }
+  else if (output != input)
+  {
+    std::copy(input, input + joint_num_, output);
+  }
+}
+
+bool StreamingSmoothingFilter::getType(const std::string &name, SmoothingType &type)
+{
+  if (name == "none")
+    type = SMOOTHING_NONE;
+  else if (name == "fir")
+    type = SMOOTHING_FIR;
+  else if (name == "low_pass")
+    type = SMOOTHING_LOW_PASS;
+  else
+    return false;
+
+  return true;
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "open_manipulator_position_ctrl/trajectory_buffer.h"
+
+#include <algorithm>
+
+using namespace open_manipulator;
+
+TrajectoryBuffer::TrajectoryBuffer()
+    :joint_num_(0),
+     stride_(1),
+     capacity_(0),
+     size_(0)
+{
+}
+
+void TrajectoryBuffer::init(uint8_t joint_num, uint32_t capacity)
+{
+  joint_num_ = joint_num;
+  stride_    = 2 * joint_num + 1;
+  capacity_  = capacity;
+  size_      = 0;
+
+  data_.assign((std::size_t)stride_ * capacity_, 0.0);
+}
+
+bool TrajectoryBuffer::push(const double *position, const double *velocity, double time)
+{
+  if (size_ >= capacity_)
+    return false;
+
+  double *waypoint = &data_[size_ * stride_];
+
+  std::copy(position, position + joint_num_, waypoint);
+
+  if (velocity != NULL)
+    std::copy(velocity, velocity + joint_num_, waypoint + joint_num_);
+  else
+    std::fill(waypoint + joint_num_, waypoint + 2 * joint_num_, 0.0);
+
+  waypoint[2 * joint_num_] = time;
+  size_++;
+
+  return true;
+}
+
+bool TrajectoryBuffer::resize(uint32_t size)
+{
+  if (size > capacity_)
+    return false;
+
+  size_ = size;
+  return true;
+}
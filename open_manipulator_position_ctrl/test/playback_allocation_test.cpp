@@ -0,0 +1,188 @@
+/*******************************************************************************
+* Copyright 2016 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The planned path playback is allocation free once a path is loaded: the trajectory buffer
+// works in place and every control tick only writes into preallocated messages. Heap
+// allocations are counted by replacing the global operator new.
+//
+// ArmController advertises topics and services, so this runs under rostest with a master.
+// Nothing subscribes to the goal and the stats topics, roscpp allocates the serialized
+// message for every subscriber and that is not counted here.
+
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+
+#include "open_manipulator_position_ctrl/arm_controller.h"
+#include "open_manipulator_position_ctrl/trajectory_buffer.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <new>
+
+using namespace open_manipulator;
+
+// Heap allocations of the test thread only, the ROS threads keep allocating meanwhile
+static thread_local bool is_counting = false;
+static thread_local uint64_t allocation_count = 0;
+
+void *operator new(std::size_t size)
+{
+  if (is_counting)
+    allocation_count++;
+
+  void *memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == NULL)
+    throw std::bad_alloc();
+
+  return memory;
+}
+
+void *operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *memory) throw()
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory) throw()
+{
+  std::free(memory);
+}
+
+static const uint32_t PATH_WAYPOINTS = 2000;    // 20 sec of playback
+static const int      PATH_REPEATS   = 50;
+
+static void startCounting()
+{
+  allocation_count = 0;
+  is_counting = true;
+}
+
+static uint64_t stopCounting()
+{
+  is_counting = false;
+  return allocation_count;
+}
+
+static double getPathPosition(uint32_t waypoint, uint8_t joint)
+{
+  const double time = (double)waypoint / ITERATION_FREQUENCY;
+  return 0.5 * std::sin(0.3 * time + joint) * (1.0 - std::cos(M_PI * waypoint / (PATH_WAYPOINTS - 1)));
+}
+
+TEST(TrajectoryBuffer, ReloadAndPlaybackDoNotAllocate)
+{
+  TrajectoryBuffer buffer;
+  buffer.init(JOINT_NUM, PATH_WAYPOINTS);
+
+  double position[JOINT_NUM];
+  double velocity[JOINT_NUM];
+  double sum = 0.0;
+
+  startCounting();
+
+  for (int repeat = 0; repeat < PATH_REPEATS; repeat++)
+  {
+    buffer.clear();
+
+    for (uint32_t waypoint = 0; waypoint < PATH_WAYPOINTS; waypoint++)
+    {
+      for (uint8_t joint = 0; joint < JOINT_NUM; joint++)
+      {
+        position[joint] = getPathPosition(waypoint, joint);
+        velocity[joint] = 0.0;
+      }
+
+      buffer.push(position, (waypoint % 2) ? velocity : NULL, (double)waypoint / ITERATION_FREQUENCY);
+    }
+
+    // Splicing shortens and regrows the path in place
+    buffer.resize(PATH_WAYPOINTS / 2);
+    buffer.resize(PATH_WAYPOINTS);
+
+    for (uint32_t waypoint = 0; waypoint < buffer.getSize(); waypoint++)
+    {
+      buffer.setTime(waypoint, buffer.getTime(waypoint) + 1.0);
+      buffer.getVelocity(waypoint)[0] = buffer.getPosition(waypoint)[0];
+      sum += buffer.getVelocity(waypoint)[0];
+    }
+  }
+
+  const uint64_t allocations = stopCounting();
+
+  EXPECT_EQ(PATH_WAYPOINTS, buffer.getSize());
+  EXPECT_TRUE(std::isfinite(sum));
+  EXPECT_EQ(0u, allocations);
+}
+
+TEST(ArmController, PlannedPathPlaybackDoesNotAllocate)
+{
+  ArmController arm_controller;
+
+  // "Complete Execution" is logged once per path, keep the console out of the count
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn))
+    ros::console::notifyLoggerLevelsChanged();
+
+  trajectory_msgs::JointTrajectory trajectory;
+  for (uint8_t joint = 0; joint < JOINT_NUM; joint++)
+    trajectory.joint_names.push_back("joint" + std::to_string(joint + 1));
+
+  trajectory.points.resize(PATH_WAYPOINTS);
+  for (uint32_t waypoint = 0; waypoint < PATH_WAYPOINTS; waypoint++)
+  {
+    for (uint8_t joint = 0; joint < JOINT_NUM; joint++)
+      trajectory.points[waypoint].positions.push_back(getPathPosition(waypoint, joint));
+
+    trajectory.points[waypoint].time_from_start = ros::Duration((double)waypoint / ITERATION_FREQUENCY);
+  }
+
+  // Two control ticks per waypoint at the default rates, with some slack
+  const uint32_t max_ticks = 4 * PATH_WAYPOINTS;
+
+  for (int repeat = 0; repeat < 3; repeat++)
+  {
+    ASSERT_TRUE(arm_controller.startPath(trajectory));
+
+    uint32_t ticks = 0;
+
+    startCounting();
+
+    while (arm_controller.isMoving() && ticks < max_ticks)
+    {
+      arm_controller.process();
+      ticks++;
+    }
+
+    const uint64_t allocations = stopCounting();
+
+    EXPECT_FALSE(arm_controller.isMoving());
+    EXPECT_EQ(PATH_COMPLETED, arm_controller.getPathResult());
+    EXPECT_GT(ticks, PATH_WAYPOINTS);
+    EXPECT_EQ(0u, allocations);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "playback_allocation_test");
+
+  return RUN_ALL_TESTS();
+}